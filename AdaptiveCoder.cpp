@@ -0,0 +1,62 @@
+#include "AdaptiveCoder.hpp"
+#include "HuffmanDecoder.hpp"
+#include "MappedFile.hpp"
+
+error_type AdaptiveCoder::decodeFile(const std::string& codeFileName, std::vector<std::string_view>& tokens) {
+    MappedFile file;
+    if (error_type status = file.open(codeFileName); status != NO_ERROR) {
+        return status;
+    }
+    std::vector<unsigned char> packed;
+    const unsigned char* bits = nullptr;
+    size_t bytes = 0;
+    uint64_t bitCount = 0;
+    if (error_type status = HuffmanDecoder::unpackCode(reinterpret_cast<const unsigned char*>(file.data()),
+                                                       file.size(), packed, bits, bytes, bitCount);
+        status != NO_ERROR) {
+        return status;
+    }
+    if (bitCount > uint64_t(bytes) * 8) return INVALID_CODE;
+
+    // Tokens are collected as word IDs and turned into views at the end,
+    // once the arena has stopped growing
+    std::vector<uint32_t> ids;
+    std::string word;
+    uint64_t pos = 0;
+    while (pos < bitCount) {
+        uint32_t id;
+        if (error_type status = words_.readSymbol(bits, bitCount, pos, id); status != NO_ERROR) {
+            return status;
+        }
+        if (id == AdaptiveHuffman::kNew) {
+            word.clear();
+            for (;;) {
+                uint32_t character;
+                if (error_type status = characters_.readSymbol(bits, bitCount, pos, character); status != NO_ERROR) {
+                    return status;
+                }
+                if (character == AdaptiveHuffman::kNew) {
+                    if (bitCount - pos < kCharacterBits) return INVALID_CODE;
+                    character = 0;
+                    for (int i = 0; i < kCharacterBits; ++i, ++pos) {
+                        character = (character << 1) | ((bits[pos >> 3] >> (7 - (pos & 7))) & 1);
+                    }
+                    if (character > kEnd) return INVALID_CODE;
+                }
+                characters_.update(character);
+                if (character == kEnd) break;
+                word += character == kApostrophe ? '\'' : static_cast<char>('a' + character);
+            }
+            id = static_cast<uint32_t>(decodedWords_.size());
+            decodedWords_.emplace_back(spelled_.add(word), static_cast<uint32_t>(word.size()));
+        }
+        words_.update(id);
+        ids.push_back(id);
+    }
+
+    tokens.reserve(tokens.size() + ids.size());
+    for (uint32_t id : ids) {
+        tokens.push_back(spelled_.view(decodedWords_[id].first, decodedWords_[id].second));
+    }
+    return NO_ERROR;
+}
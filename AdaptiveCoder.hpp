@@ -0,0 +1,81 @@
+#ifndef ADAPTIVECODER_HPP
+#define ADAPTIVECODER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "utils.hpp"
+#include "AdaptiveHuffman.hpp"
+#include "StringArena.hpp"
+#include "TokenInterner.hpp"
+
+// One-pass coding of a token stream (--adaptive) with two adaptive codes:
+//   words       - word IDs, in order of first occurrence
+//   characters  - 'a'..'z', the apostrophe and kEnd, to spell new words
+// A word seen before is coded as itself. A new word is the word code's NYT,
+// then its characters and kEnd in the character code. A character seen for
+// the first time is the character code's NYT followed by its kCharacterBits-bit
+// index. Encoder and decoder build the same words in the same order, so
+// the stream needs nothing else.
+class AdaptiveCoder {
+public:
+    static constexpr uint32_t kApostrophe = 26;
+    static constexpr uint32_t kEnd = 27;
+    static constexpr int kCharacterBits = 5;
+
+    // Pass the code of 'token' (a Scanner token) to write(code, length) in
+    // pieces of at most 64 bits, and update the codes
+    template <typename Write>
+    void putToken(std::string_view token, Write&& write);
+
+    // Decode a binary or ASCII .code file written by putToken(). The views
+    // point into this object and stay valid until the next decode.
+    error_type decodeFile(const std::string& codeFileName, std::vector<std::string_view>& tokens);
+
+    // Distinct words so far
+    size_t size() const { return interner_.size(); }
+
+private:
+    template <typename Write>
+    void putCharacter(uint32_t character, Write& write);
+
+    AdaptiveHuffman words_;
+    AdaptiveHuffman characters_;
+    TokenInterner interner_;   // encoder: word -> ID
+    StringArena spelled_;      // decoder: words by ID
+    std::vector<std::pair<size_t, uint32_t>> decodedWords_;   // (offset, length) in spelled_
+};
+
+template <typename Write>
+void AdaptiveCoder::putToken(std::string_view token, Write&& write) {
+    const uint32_t id = interner_.intern(token);
+    if (words_.contains(id)) {
+        words_.writeCode(id, write);
+        words_.update(id);
+        return;
+    }
+
+    words_.writeCode(AdaptiveHuffman::kNew, write);
+    for (char c : token) {
+        putCharacter(c == '\'' ? kApostrophe : static_cast<uint32_t>(c - 'a'), write);
+    }
+    putCharacter(kEnd, write);
+    words_.update(id);
+}
+
+template <typename Write>
+void AdaptiveCoder::putCharacter(uint32_t character, Write& write) {
+    if (characters_.contains(character)) {
+        characters_.writeCode(character, write);
+    } else {
+        characters_.writeCode(AdaptiveHuffman::kNew, write);
+        write(character, kCharacterBits);
+    }
+    characters_.update(character);
+}
+
+#endif // ADAPTIVECODER_HPP
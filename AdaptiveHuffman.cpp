@@ -0,0 +1,106 @@
+#include "AdaptiveHuffman.hpp"
+
+#include <utility>
+
+AdaptiveHuffman::AdaptiveHuffman() : root_(0), nyt_(0) {
+    nyt_ = root_ = addNode(kNone, kNew, 1);
+}
+
+uint32_t AdaptiveHuffman::addNode(uint32_t parent, uint32_t symbol, uint64_t weight) {
+    const uint32_t node = static_cast<uint32_t>(nodes_.size());
+    const uint32_t rank = static_cast<uint32_t>(order_.size());
+    nodes_.push_back(Node{weight, parent, {kNone, kNone}, symbol, rank, joinBlock(rank, weight)});
+    order_.push_back(node);
+    return node;
+}
+
+// Block for a node of 'weight' that now sits at 'rank', right after the
+// block's other nodes (if any)
+uint32_t AdaptiveHuffman::joinBlock(uint32_t rank, uint64_t weight) {
+    if (rank > 0) {
+        const Node& previous = nodes_[order_[rank - 1]];
+        if (previous.weight == weight) return previous.block;
+    }
+    if (freeBlocks_.empty()) {
+        leaders_.push_back(rank);
+        return static_cast<uint32_t>(leaders_.size() - 1);
+    }
+    const uint32_t block = freeBlocks_.back();
+    freeBlocks_.pop_back();
+    leaders_[block] = rank;
+    return block;
+}
+
+error_type AdaptiveHuffman::readSymbol(const unsigned char* data, uint64_t bitCount, uint64_t& pos,
+                                       uint32_t& symbol) const {
+    uint32_t node = root_;
+    while (nodes_[node].child[0] != kNone) {
+        if (pos >= bitCount) return INVALID_CODE;
+        const bool bit = (data[pos >> 3] >> (7 - (pos & 7))) & 1;
+        node = nodes_[node].child[bit];
+        ++pos;
+    }
+    symbol = nodes_[node].symbol;
+    return NO_ERROR;
+}
+
+void AdaptiveHuffman::update(uint32_t symbol) {
+    if (contains(symbol)) {
+        for (uint32_t node = leaves_[symbol]; node != kNone; node = nodes_[node].parent) {
+            increment(node);
+        }
+        return;
+    }
+
+    // The NYT leaf becomes an internal node over the NYT (left) and the new
+    // leaf (right). Both go last in rank order: the NYT with its weight of
+    // 1, which its old node already counts, and the leaf with 0.
+    const uint32_t parent = nyt_;
+    nyt_ = addNode(parent, kNew, 1);
+    const uint32_t leaf = addNode(parent, symbol, 0);
+    nodes_[parent].child[0] = nyt_;
+    nodes_[parent].child[1] = leaf;
+    nodes_[parent].symbol = kNone;
+    if (symbol >= leaves_.size()) {
+        leaves_.resize(static_cast<size_t>(symbol) + 1, kNone);
+    }
+    leaves_[symbol] = leaf;
+
+    for (uint32_t node = leaf; node != kNone; node = nodes_[node].parent) {
+        increment(node);
+    }
+}
+
+// Move 'node' to the front of its weight's block, then add one to its weight:
+// it becomes the last node of the next block up
+void AdaptiveHuffman::increment(uint32_t node) {
+    const uint64_t weight = nodes_[node].weight;
+    const uint32_t block = nodes_[node].block;
+    const uint32_t leader = order_[leaders_[block]];
+    if (leader != node) {
+        swapNodes(node, leader);
+    }
+
+    const uint32_t rank = nodes_[node].rank;
+    if (rank + 1 < order_.size() && nodes_[order_[rank + 1]].block == block) {
+        leaders_[block] = rank + 1;
+    } else {
+        freeBlocks_.push_back(block);
+    }
+    nodes_[node].weight = weight + 1;
+    nodes_[node].block = joinBlock(rank, weight + 1);
+}
+
+// Exchange the places of two nodes (and their subtrees) in the tree and in
+// rank order
+void AdaptiveHuffman::swapNodes(uint32_t a, uint32_t b) {
+    Node& first = nodes_[a];
+    Node& second = nodes_[b];
+    uint32_t& slotA = nodes_[first.parent].child[nodes_[first.parent].child[1] == a];
+    uint32_t& slotB = nodes_[second.parent].child[nodes_[second.parent].child[1] == b];
+    std::swap(slotA, slotB);
+    std::swap(first.parent, second.parent);
+    std::swap(first.rank, second.rank);
+    order_[first.rank] = a;
+    order_[second.rank] = b;
+}
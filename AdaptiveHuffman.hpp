@@ -0,0 +1,97 @@
+#ifndef ADAPTIVEHUFFMAN_HPP
+#define ADAPTIVEHUFFMAN_HPP
+
+#include <cstdint>
+#include <vector>
+
+#include "utils.hpp"
+
+// One-pass (dynamic) Huffman code, FGK algorithm. The encoder and decoder
+// start from the same tree, a lone NYT ("not yet transmitted") leaf, and
+// update it the same way after every symbol. So the code always fits the
+// counts seen so far, and no header is needed. A symbol seen for the first
+// time is sent as the NYT's code followed by whatever spells it out (see
+// AdaptiveCoder); the NYT leaf then splits into the NYT and the new leaf.
+//
+// Nodes are kept in rank order (rank 0 = root) with weights that never
+// increase, as in the sibling property. Before a node's weight goes up by
+// one, it is swapped with the first node of its weight (the block leader:
+// every node points to the block of nodes sharing its weight, which holds
+// the leader's rank). An update therefore costs O(code length), with no
+// hashing or allocation.
+//
+// Unlike textbook FGK, the NYT weighs 1 instead of 0. Every internal node
+// then weighs more than either child, so a block leader is never an
+// ancestor or descendant of the node swapped with it, and the split NYT and
+// its new sibling can simply be appended in rank order.
+class AdaptiveHuffman {
+public:
+    static constexpr uint32_t kNew = UINT32_MAX;   // the NYT's symbol
+
+    AdaptiveHuffman();
+
+    // Whether 'symbol' has been seen
+    bool contains(uint32_t symbol) const { return symbol < leaves_.size() && leaves_[symbol] != kNone; }
+
+    // Pass the current code of 'symbol' (kNew for the NYT) to write(code,
+    // length), right-aligned, in pieces of at most 64 bits
+    template <typename Write>
+    void writeCode(uint32_t symbol, Write&& write);
+
+    // Read the code starting at bit 'pos' of 'data' (MSB first, 'bitCount'
+    // bits in all) and advance 'pos' past it
+    error_type readSymbol(const unsigned char* data, uint64_t bitCount, uint64_t& pos,
+                          uint32_t& symbol) const;
+
+    // Count one more occurrence of 'symbol', adding it if it is new
+    void update(uint32_t symbol);
+
+private:
+    static constexpr uint32_t kNone = UINT32_MAX;
+
+    struct Node {
+        uint64_t weight;
+        uint32_t parent;
+        uint32_t child[2];   // kNone for leaves
+        uint32_t symbol;     // leaves only
+        uint32_t rank;
+        uint32_t block;      // index in leaders_ of the nodes with this weight
+    };
+
+    uint32_t addNode(uint32_t parent, uint32_t symbol, uint64_t weight);
+    void increment(uint32_t node);
+    void swapNodes(uint32_t a, uint32_t b);
+    uint32_t joinBlock(uint32_t rank, uint64_t weight);
+
+    std::vector<Node> nodes_;
+    std::vector<uint32_t> order_;                      // rank -> node
+    std::vector<uint32_t> leaves_;                     // symbol -> leaf
+    std::vector<uint32_t> leaders_;                    // block -> lowest rank in it
+    std::vector<uint32_t> freeBlocks_;                 // unused entries of leaders_
+    uint32_t root_;
+    uint32_t nyt_;
+    std::vector<uint8_t> path_;                        // writeCode() scratch
+};
+
+template <typename Write>
+void AdaptiveHuffman::writeCode(uint32_t symbol, Write&& write) {
+    // Walk leaf to root, then emit the bits root first
+    path_.clear();
+    for (uint32_t node = symbol == kNew ? nyt_ : leaves_[symbol]; node != root_; node = nodes_[node].parent) {
+        path_.push_back(nodes_[nodes_[node].parent].child[1] == node);
+    }
+
+    uint64_t code = 0;
+    int length = 0;
+    for (size_t i = path_.size(); i-- > 0;) {
+        code = (code << 1) | path_[i];
+        if (++length == 64) {
+            write(code, length);
+            code = 0;
+            length = 0;
+        }
+    }
+    if (length > 0) write(code, length);
+}
+
+#endif // ADAPTIVEHUFFMAN_HPP
@@ -1,103 +1,251 @@
 #include "BST.hpp"
 #include <algorithm>
-#include <limits>
+#include <array>
 
-BST::BST() : root_(nullptr) {}
+BST::BST(CounterBackend backend)
+    : nodes_(1, Node{0, 0, 0, kNil, kNil, 0}), root_(kNil), backend_(backend),
+      hash_(backend == CounterBackend::Hash ? std::make_unique<HashCounter>() : nullptr),
+      uniqueWords_(0), maxDepth_(0) {}
 
-BST::~BST() {
-    destroy(root_);
+CounterBackend BST::backend() const {
+    return backend_;
 }
 
-void BST::destroy(Node* node) {
-    if (node == nullptr) return;
-    destroy(node->left);
-    destroy(node->right);
-    delete node;
+// The node pool and the word arena are each released with one deallocation
+BST::~BST() = default;
+
+BST::Index BST::newNode(std::string_view word, size_t count) {
+    const size_t offset = words_.add(word);
+    nodes_.push_back(Node{count, offset, static_cast<uint32_t>(word.size()), kNil, kNil, 1});
+    return static_cast<Index>(nodes_.size() - 1);
 }
 
-void BST::insert(const std::string& word) {
-    insert(root_, word);
+std::string_view BST::wordOf(Index node) const {
+    return words_.view(nodes_[node].wordOffset, nodes_[node].wordLength);
 }
 
-void BST::insert(Node*& node, const std::string& word) {
-    if (node == nullptr) {
-        node = new Node(word);
-        return;
+void BST::insert(std::string_view word) {
+    insert(word, 1);
+}
+
+void BST::insert(std::string_view word, size_t count) {
+    if (hash_) {
+        hash_->insert(word, count);
+    } else if (backend_ == CounterBackend::Avl) {
+        insertAvl(word, count);
+    } else {
+        insertUnbalanced(word, count);
     }
-    
-    if (word == node->word) {
-        // Word already exists, increment count
-        node->count++;
-    } else if (word < node->word) {
-        insert(node->left, word);
+}
+
+void BST::recordCount(size_t oldCount, size_t newCount) {
+    // oldCount == 0 means the word is new
+    auto it = wordsPerCount_.end();
+    if (oldCount != 0) {
+        it = wordsPerCount_.find(oldCount);
+        auto next = std::next(it);
+        if (--it->second == 0) {
+            wordsPerCount_.erase(it);
+        }
+        it = next;
+    } else {
+        ++uniqueWords_;
+    }
+
+    // New entries go right after the old count in the common +1 case
+    if (it != wordsPerCount_.end() && it->first == newCount) {
+        ++it->second;
     } else {
-        insert(node->right, word);
+        wordsPerCount_[newCount]++;
     }
 }
 
+void BST::insertUnbalanced(std::string_view word, size_t count) {
+    if (root_ == kNil) {
+        root_ = newNode(word, count);
+        maxDepth_ = 1;
+        recordCount(0, count);
+        return;
+    }
+
+    Index node = root_;
+    int depth = 1;
+    while (true) {
+        int cmp = word.compare(wordOf(node));
+        if (cmp == 0) {
+            // Word already exists, increment count
+            nodes_[node].count += count;
+            recordCount(nodes_[node].count - count, nodes_[node].count);
+            return;
+        }
+        ++depth;
+        Index next = cmp < 0 ? nodes_[node].left : nodes_[node].right;
+        if (next == kNil) {
+            // newNode() may grow the pool, so link by index afterwards
+            Index child = newNode(word, count);
+            (cmp < 0 ? nodes_[node].left : nodes_[node].right) = child;
+            break;
+        }
+        node = next;
+    }
+
+    maxDepth_ = std::max(maxDepth_, depth);
+    recordCount(0, count);
+}
+
+void BST::updateHeight(Index node) {
+    nodes_[node].height = 1 + std::max(height(nodes_[node].left), height(nodes_[node].right));
+}
+
+BST::Index BST::rotateLeft(Index node) {
+    Index pivot = nodes_[node].right;
+    nodes_[node].right = nodes_[pivot].left;
+    nodes_[pivot].left = node;
+    updateHeight(node);
+    updateHeight(pivot);
+    return pivot;
+}
+
+BST::Index BST::rotateRight(Index node) {
+    Index pivot = nodes_[node].left;
+    nodes_[node].left = nodes_[pivot].right;
+    nodes_[pivot].right = node;
+    updateHeight(node);
+    updateHeight(pivot);
+    return pivot;
+}
+
+BST::Index BST::rebalance(Index node) {
+    updateHeight(node);
+    const Node& n = nodes_[node];
+    int balance = height(n.left) - height(n.right);
+
+    if (balance > 1) {
+        if (height(nodes_[n.left].left) < height(nodes_[n.left].right)) {
+            nodes_[node].left = rotateLeft(n.left);
+        }
+        return rotateRight(node);
+    }
+    if (balance < -1) {
+        if (height(nodes_[n.right].right) < height(nodes_[n.right].left)) {
+            nodes_[node].right = rotateRight(n.right);
+        }
+        return rotateLeft(node);
+    }
+    return node;
+}
+
+void BST::insertAvl(std::string_view word, size_t count) {
+    // An AVL tree of height h has at least Fib(h + 2) - 1 nodes, so 128 levels
+    // are far more than any 32-bit index space can reach.
+    std::array<Index, 128> path;
+    std::array<bool, 128> wentLeft;
+    size_t depth = 0;
+    Index node = root_;
+
+    while (node != kNil) {
+        int cmp = word.compare(wordOf(node));
+        if (cmp == 0) {
+            nodes_[node].count += count;
+            recordCount(nodes_[node].count - count, nodes_[node].count);
+            return;
+        }
+        path[depth] = node;
+        wentLeft[depth] = cmp < 0;
+        ++depth;
+        node = cmp < 0 ? nodes_[node].left : nodes_[node].right;
+    }
+
+    Index child = newNode(word, count);
+    recordCount(0, count);
+
+    // Link the new node, then retrace towards the root; stop once a
+    // subtree's height is unchanged
+    while (depth > 0) {
+        --depth;
+        Index parent = path[depth];
+        (wentLeft[depth] ? nodes_[parent].left : nodes_[parent].right) = child;
+
+        int before = nodes_[parent].height;
+        child = rebalance(parent);
+        if (child == parent && nodes_[parent].height == before) {
+            return;
+        }
+        if (nodes_[child].height == before) {
+            // Rotated into a subtree of the same height: relink it and stop
+            if (depth == 0) {
+                root_ = child;
+            } else {
+                Index above = path[depth - 1];
+                (wentLeft[depth - 1] ? nodes_[above].left : nodes_[above].right) = child;
+            }
+            return;
+        }
+    }
+    root_ = child;
+}
+
 void BST::buildFromTokens(const std::vector<std::string>& tokens) {
     for (const auto& token : tokens) {
         insert(token);
     }
 }
 
-int BST::getHeight() const {
-    return height(root_);
+void BST::buildFromTokens(const std::vector<std::string_view>& tokens) {
+    for (std::string_view token : tokens) {
+        insert(token);
+    }
 }
 
-int BST::height(Node* node) const {
-    if (node == nullptr) return 0;
-    
-    int leftHeight = height(node->left);
-    int rightHeight = height(node->right);
-    
-    return 1 + std::max(leftHeight, rightHeight);
+int BST::getHeight() const {
+    if (hash_) return hash_->getMaxProbeLength();
+    if (backend_ == CounterBackend::Avl) return height(root_);
+    return maxDepth_;
 }
 
 size_t BST::getUniqueWords() const {
-    if (root_ == nullptr) return 0;
-    
-    std::vector<std::pair<std::string, size_t>> frequencies;
-    inorderTraversal(root_, frequencies);
-    return frequencies.size();
+    if (hash_) return hash_->size();
+    return uniqueWords_;
 }
 
 std::vector<std::pair<std::string, size_t>> BST::getFrequencies() const {
+    if (hash_) return hash_->getFrequencies();
     std::vector<std::pair<std::string, size_t>> result;
+    result.reserve(uniqueWords_);
     inorderTraversal(root_, result);
     return result;
 }
 
-void BST::inorderTraversal(Node* node, std::vector<std::pair<std::string, size_t>>& result) const {
-    if (node == nullptr) return;
-    
-    inorderTraversal(node->left, result);
-    result.push_back({node->word, node->count});
-    inorderTraversal(node->right, result);
+void BST::inorderTraversal(Index node, std::vector<std::pair<std::string, size_t>>& result) const {
+    // Explicit stack of pending ancestors instead of recursion
+    std::vector<Index> stack;
+    while (node != kNil || !stack.empty()) {
+        while (node != kNil) {
+            stack.push_back(node);
+            node = nodes_[node].left;
+        }
+        node = stack.back();
+        stack.pop_back();
+        result.push_back({std::string(wordOf(node)), nodes_[node].count});
+        node = nodes_[node].right;
+    }
 }
 
 void BST::getMinMaxFrequency(size_t& minFreq, size_t& maxFreq) const {
-    if (root_ == nullptr) {
+    if (hash_) {
+        hash_->getMinMaxFrequency(minFreq, maxFreq);
+        return;
+    }
+    if (wordsPerCount_.empty()) {
         minFreq = 0;
         maxFreq = 0;
         return;
     }
     
-    minFreq = std::numeric_limits<size_t>::max();
-    maxFreq = 0;
-    getMinMax(root_, minFreq, maxFreq);
-}
-
-void BST::getMinMax(Node* node, size_t& minFreq, size_t& maxFreq) const {
-    if (node == nullptr) return;
-    
-    minFreq = std::min(minFreq, node->count);
-    maxFreq = std::max(maxFreq, node->count);
-    
-    getMinMax(node->left, minFreq, maxFreq);
-    getMinMax(node->right, minFreq, maxFreq);
+    minFreq = wordsPerCount_.begin()->first;
+    maxFreq = wordsPerCount_.rbegin()->first;
 }
 
 bool BST::isEmpty() const {
-    return root_ == nullptr;
-}
\ No newline at end of file
+    return hash_ ? hash_->isEmpty() : root_ == kNil;
+}
@@ -2,54 +2,102 @@
 #define BST_HPP
 
 #include <string>
+#include <string_view>
 #include <vector>
 #include <utility>
+#include <memory>
+#include <map>
+#include <cstdint>
+#include "HashCounter.hpp"
+#include "StringArena.hpp"
+
+// Counting backends selectable at runtime
+enum class CounterBackend {
+    Tree,   // unbalanced binary search tree (default)
+    Avl,    // height-balanced (AVL) binary search tree
+    Hash,   // open-addressing hash table, sorted once by getFrequencies()
+};
 
 class BST {
 private:
+    // Nodes live in one contiguous pool and refer to each other by 32-bit
+    // index; words are (offset, length) into a shared StringArena. Index 0 is
+    // a sentinel that plays the role of nullptr (its height is 0).
+    // 32 bytes per node, versus 64 for the old pointer/std::string node plus
+    // its malloc header.
+    using Index = uint32_t;
+    static constexpr Index kNil = 0;
+
     struct Node {
-        std::string word;
         size_t count;
-        Node* left;
-        Node* right;
-        
-        Node(const std::string& w) 
-            : word(w), count(1), left(nullptr), right(nullptr) {}
+        size_t wordOffset;
+        uint32_t wordLength;
+        Index left;
+        Index right;
+        int height;            // subtree height, maintained for the AVL backend
     };
     
-    Node* root_;
+    std::vector<Node> nodes_;     // nodes_[0] is the kNil sentinel
+    StringArena words_;
+    Index root_;
+    CounterBackend backend_;
+    std::unique_ptr<HashCounter> hash_;   // only for CounterBackend::Hash
+
+    // Statistics maintained on every insert, so queries never walk the tree
+    size_t uniqueWords_;
+    int maxDepth_;                          // height of the unbalanced tree
+    std::map<size_t, size_t> wordsPerCount_; // count -> number of words with it
     
-    // Helper functions
-    void insert(Node*& node, const std::string& word);
-    void destroy(Node* node);
-    int height(Node* node) const;
-    void inorderTraversal(Node* node, std::vector<std::pair<std::string, size_t>>& result) const;
-    void getMinMax(Node* node, size_t& minFreq, size_t& maxFreq) const;
+    // Helper functions (all iterative: no recursion depth tied to tree height)
+    Index newNode(std::string_view word, size_t count);
+    std::string_view wordOf(Index node) const;
+    void insertUnbalanced(std::string_view word, size_t count);
+    void insertAvl(std::string_view word, size_t count);
+    void recordCount(size_t oldCount, size_t newCount);
+    void inorderTraversal(Index node, std::vector<std::pair<std::string, size_t>>& result) const;
+
+    // AVL helpers
+    int height(Index node) const { return nodes_[node].height; }
+    void updateHeight(Index node);
+    Index rotateLeft(Index node);
+    Index rotateRight(Index node);
+    Index rebalance(Index node);
     
 public:
-    BST();
+    explicit BST(CounterBackend backend = CounterBackend::Tree);
     ~BST();
+
+    // Backend chosen at construction
+    CounterBackend backend() const;
     
     // Insert a word (or increment count if it exists)
-    void insert(const std::string& word);
+    void insert(std::string_view word);
+
+    // Insert a word with an initial count (or add to its count if it exists)
+    void insert(std::string_view word, size_t count);
     
     // Build BST from a vector of tokens
     void buildFromTokens(const std::vector<std::string>& tokens);
+    void buildFromTokens(const std::vector<std::string_view>& tokens);
     
-    // Get tree height (0 for empty tree)
+    // Get tree height (0 for empty tree).
+    // Hash backend: longest probe sequence instead (see HashCounter).
     int getHeight() const;
     
-    // Get number of unique words
+    // Get number of unique words (O(1))
     size_t getUniqueWords() const;
     
     // Get all (word, count) pairs in lexicographic order
     std::vector<std::pair<std::string, size_t>> getFrequencies() const;
     
-    // Get min and max frequencies
+    // Get min and max frequencies (O(1) for the tree backends)
     void getMinMaxFrequency(size_t& minFreq, size_t& maxFreq) const;
     
     // Check if tree is empty
     bool isEmpty() const;
+
+    // Bytes of node storage per node (excluding the word bytes in the arena)
+    static constexpr size_t bytesPerNode() { return sizeof(Node); }
 };
 
 #endif // BST_HPP
\ No newline at end of file
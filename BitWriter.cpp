@@ -0,0 +1,71 @@
+#include "BitWriter.hpp"
+#include <algorithm>
+#include <cstring>
+
+BitWriter::BitWriter(std::ostream& os, size_t bufferBytes)
+    // Whole words only, and room for the tail plus trailer in finish()
+    : os_(os), buffer_(std::max<size_t>(bufferBytes, 32) / 8 * 8), fill_(0),
+      acc_(0), used_(0), totalBits_(0) {}
+
+void BitWriter::flushWord() {
+    if (fill_ == buffer_.size()) {
+        flushBuffer();
+    }
+    for (int shift = 56; shift >= 0; shift -= 8) {
+        buffer_[fill_++] = static_cast<unsigned char>(acc_ >> shift);
+    }
+}
+
+void BitWriter::flushBuffer() {
+    os_.write(reinterpret_cast<const char*>(buffer_.data()), fill_);
+    fill_ = 0;
+}
+
+error_type BitWriter::flush() {
+    if (!os_.good()) {
+        return UNABLE_TO_OPEN_FILE_FOR_WRITING;
+    }
+
+    // Whole bytes of the partial accumulator, zero-padded
+    flushBuffer();
+    const int tailBytes = (used_ + 7) / 8;
+    for (int i = 0; i < tailBytes; ++i) {
+        buffer_[fill_++] = static_cast<unsigned char>(acc_ >> (56 - 8 * i));
+    }
+    flushBuffer();
+    acc_ = 0;
+    used_ = 0;
+
+    if (!os_) return FAILED_TO_WRITE_FILE;
+    return NO_ERROR;
+}
+
+void BitWriter::flushWholeBytes() {
+    flushBuffer();
+    const int wholeBytes = used_ / 8;
+    for (int i = 0; i < wholeBytes; ++i) {
+        buffer_[fill_++] = static_cast<unsigned char>(acc_ >> (56 - 8 * i));
+    }
+    flushBuffer();
+    acc_ = wholeBytes < 8 ? acc_ << (8 * wholeBytes) : 0;
+    used_ -= 8 * wholeBytes;
+}
+
+error_type BitWriter::finish() {
+    if (error_type status = flush(); status != NO_ERROR) {
+        return status;
+    }
+    return writeTrailer(os_, totalBits_);
+}
+
+error_type BitWriter::writeTrailer(std::ostream& os, uint64_t totalBits) {
+    unsigned char trailer[kTrailerBytes];
+    for (int i = 0; i < 8; ++i) {
+        trailer[i] = static_cast<unsigned char>(totalBits >> (8 * i));
+    }
+    std::memcpy(trailer + 8, kMagic, sizeof(kMagic));
+    os.write(reinterpret_cast<const char*>(trailer), kTrailerBytes);
+
+    if (!os) return FAILED_TO_WRITE_FILE;
+    return NO_ERROR;
+}
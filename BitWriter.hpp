@@ -0,0 +1,77 @@
+#ifndef BITWRITER_HPP
+#define BITWRITER_HPP
+
+#include <cstdint>
+#include <ostream>
+#include <vector>
+#include "utils.hpp"
+
+// Packs variable-length codes into a binary bitstream.
+//
+// Bits go most significant first into a 64-bit accumulator; each full
+// accumulator is stored big-endian into a large byte buffer, which is written
+// to the stream only when full. finish() pads the last byte with zeros and
+// appends the trailer:
+//   <total bits, 8 bytes little-endian> "HFB1"
+// so a reader knows exactly how many bits of the final byte are real.
+class BitWriter {
+public:
+    // Trailer magic, last 4 bytes of a binary .code file
+    static constexpr char kMagic[4] = {'H', 'F', 'B', '1'};
+    static constexpr size_t kTrailerBytes = 8 + sizeof(kMagic);
+
+    explicit BitWriter(std::ostream& os, size_t bufferBytes = 1 << 16);
+
+    // Append the low 'length' bits of 'code' (0 <= length <= 64)
+    void write(uint64_t code, int length) {
+        if (length == 0) return;
+        if (length < 64) code &= (1ULL << length) - 1;
+        totalBits_ += length;
+
+        const int free = 64 - used_;
+        if (length < free) {
+            acc_ |= code << (free - length);
+            used_ += length;
+            return;
+        }
+
+        // Fill the accumulator, flush it, and keep the remaining low bits
+        const int rest = length - free;
+        acc_ |= code >> rest;
+        flushWord();
+        acc_ = rest ? code << (64 - rest) : 0;
+        used_ = rest;
+    }
+
+    // Zero-pad to a byte boundary and write everything buffered (no trailer)
+    error_type flush();
+
+    // Write everything buffered up to the last complete byte, keeping the
+    // bits of a partial byte for later (no padding, unlike flush())
+    void flushWholeBytes();
+
+    // Flush everything and write the trailer
+    error_type finish();
+
+    // Count 'bits' already in the stream ahead of this writer (when appending
+    // to an existing stream); they only show in totalBits() and the trailer
+    void addPrecedingBits(uint64_t bits) { totalBits_ += bits; }
+
+    uint64_t totalBits() const { return totalBits_; }
+
+    // Write the trailer for a stream of 'totalBits' bits (finish() uses this)
+    static error_type writeTrailer(std::ostream& os, uint64_t totalBits);
+
+private:
+    void flushWord();
+    void flushBuffer();
+
+    std::ostream& os_;
+    std::vector<unsigned char> buffer_;
+    size_t fill_;
+    uint64_t acc_;
+    int used_;           // bits of acc_ in use, from the top
+    uint64_t totalBits_;
+};
+
+#endif // BITWRITER_HPP
@@ -0,0 +1,109 @@
+#include "BlockIndex.hpp"
+#include <algorithm>
+#include <array>
+#include <cstring>
+
+BlockIndex::BlockIndex() : tokensPerBlock(0) {}
+
+static void putLittleEndian(unsigned char* out, uint64_t value, int bytes) {
+    for (int i = 0; i < bytes; ++i) {
+        out[i] = static_cast<unsigned char>(value >> (8 * i));
+    }
+}
+
+static uint64_t getLittleEndian(const unsigned char* in, int bytes) {
+    uint64_t value = 0;
+    for (int i = bytes - 1; i >= 0; --i) {
+        value = (value << 8) | in[i];
+    }
+    return value;
+}
+
+bool BlockIndex::isContainer(const unsigned char* data, size_t size) {
+    return size >= kTrailerBytes &&
+           std::memcmp(data + size - sizeof(kMagic), kMagic, sizeof(kMagic)) == 0;
+}
+
+error_type BlockIndex::read(const unsigned char* data, size_t size) {
+    blocks.clear();
+    if (!isContainer(data, size)) return INVALID_CODE;
+
+    const unsigned char* trailer = data + size - kTrailerBytes;
+    const uint64_t count = getLittleEndian(trailer, 8);
+    tokensPerBlock = getLittleEndian(trailer + 8, 8);
+    if (count > (size - kTrailerBytes) / kEntryBytes) return INVALID_CODE;
+
+    const size_t indexStart = size - kTrailerBytes - count * kEntryBytes;
+    blocks.reserve(count);
+    uint64_t nextBit = 0, nextToken = 0;
+    for (uint64_t i = 0; i < count; ++i) {
+        const unsigned char* entry = data + indexStart + i * kEntryBytes;
+        BlockEntry block{getLittleEndian(entry, 8), getLittleEndian(entry + 8, 8),
+                         getLittleEndian(entry + 16, 8),
+                         static_cast<uint32_t>(getLittleEndian(entry + 24, 4)),
+                         static_cast<uint32_t>(getLittleEndian(entry + 28, 4))};
+
+        // Blocks are contiguous, byte aligned and lie before the index
+        if (block.bitOffset != nextBit || block.firstToken != nextToken ||
+            block.bitCount > uint64_t(indexStart) * 8 - block.bitOffset) {
+            return INVALID_CODE;
+        }
+        nextBit = block.bitOffset + (block.bitCount + 7) / 8 * 8;
+        nextToken = block.firstToken + block.tokenCount;
+        blocks.push_back(block);
+    }
+    return nextBit == uint64_t(indexStart) * 8 ? NO_ERROR : INVALID_CODE;
+}
+
+error_type BlockIndex::write(std::ostream& os) const {
+    if (!os.good()) {
+        return UNABLE_TO_OPEN_FILE_FOR_WRITING;
+    }
+
+    unsigned char entry[kEntryBytes];
+    for (const BlockEntry& block : blocks) {
+        putLittleEndian(entry, block.bitOffset, 8);
+        putLittleEndian(entry + 8, block.bitCount, 8);
+        putLittleEndian(entry + 16, block.firstToken, 8);
+        putLittleEndian(entry + 24, block.tokenCount, 4);
+        putLittleEndian(entry + 28, block.crc, 4);
+        os.write(reinterpret_cast<const char*>(entry), kEntryBytes);
+    }
+
+    unsigned char trailer[kTrailerBytes];
+    putLittleEndian(trailer, blocks.size(), 8);
+    putLittleEndian(trailer + 8, tokensPerBlock, 8);
+    std::memcpy(trailer + 16, kMagic, sizeof(kMagic));
+    os.write(reinterpret_cast<const char*>(trailer), kTrailerBytes);
+
+    if (!os) return FAILED_TO_WRITE_FILE;
+    return NO_ERROR;
+}
+
+size_t BlockIndex::blockOf(uint64_t token) const {
+    // Last block whose first token is <= token
+    auto it = std::upper_bound(blocks.begin(), blocks.end(), token,
+                               [](uint64_t t, const BlockEntry& block) { return t < block.firstToken; });
+    if (it == blocks.begin() || token >= totalTokens()) return blocks.size();
+    return static_cast<size_t>(it - blocks.begin()) - 1;
+}
+
+uint32_t BlockIndex::crc32(const unsigned char* data, size_t size, uint32_t crc) {
+    static const std::array<uint32_t, 256> table = [] {
+        std::array<uint32_t, 256> t{};
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k) {
+                c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            }
+            t[i] = c;
+        }
+        return t;
+    }();
+
+    crc = ~crc;
+    for (size_t i = 0; i < size; ++i) {
+        crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    }
+    return ~crc;
+}
@@ -0,0 +1,57 @@
+#ifndef BLOCKINDEX_HPP
+#define BLOCKINDEX_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+#include "utils.hpp"
+
+// Seek index of the block container (.code written with --block-tokens=N
+// and/or --block-bytes=N).
+//
+// The payload is split into blocks of N tokens, or of about N payload bytes
+// each (a block ends with the token that takes it to N bytes). Each block starts on a byte
+// boundary and is a complete bitstream on its own, so any block decodes
+// without the ones before it. Layout:
+//   <block 0> <block 1> ... <index> <trailer>
+//   index   : per block, 32 bytes little-endian:
+//             bit offset (8) | bit count (8) | first token (8) | tokens (4) | CRC-32 of its bytes (4)
+//   trailer : block count (8) | tokens per block (8; 0 if only bytes bound it) | "HFC1"
+struct BlockEntry {
+    uint64_t bitOffset;    // from the start of the file; always a multiple of 8
+    uint64_t bitCount;
+    uint64_t firstToken;
+    uint32_t tokenCount;
+    uint32_t crc;
+};
+
+class BlockIndex {
+public:
+    static constexpr char kMagic[4] = {'H', 'F', 'C', '1'};
+    static constexpr size_t kEntryBytes = 32;
+    static constexpr size_t kTrailerBytes = 16 + sizeof(kMagic);
+
+    BlockIndex();
+
+    // True if the last bytes of 'data' are the container magic
+    static bool isContainer(const unsigned char* data, size_t size);
+
+    // Parse the index and trailer at the end of data[0, size)
+    error_type read(const unsigned char* data, size_t size);
+
+    // Append the index and trailer
+    error_type write(std::ostream& os) const;
+
+    // Block holding token 'token' (blocks() if it is past the end)
+    size_t blockOf(uint64_t token) const;
+
+    // CRC-32 (IEEE, as in zlib) of data[0, size), continuing from 'crc'
+    static uint32_t crc32(const unsigned char* data, size_t size, uint32_t crc = 0);
+
+    std::vector<BlockEntry> blocks;
+    uint64_t tokensPerBlock;   // 0: blocks vary in tokens; use blockOf()
+    uint64_t totalTokens() const { return blocks.empty() ? 0 : blocks.back().firstToken + blocks.back().tokenCount; }
+};
+
+#endif // BLOCKINDEX_HPP
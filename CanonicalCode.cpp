@@ -0,0 +1,201 @@
+#include "CanonicalCode.hpp"
+#include "BitWriter.hpp"
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+
+CanonicalCode::CanonicalCode() : maxLength_(0) {}
+
+error_type CanonicalCode::build(std::vector<std::pair<std::string, int>> lengths) {
+    std::sort(lengths.begin(), lengths.end());
+
+    words_.clear();
+    entries_.clear();
+    entries_.reserve(lengths.size());
+    for (const auto& [word, codeLength] : lengths) {
+        size_t offset = words_.add(word);
+        entries_.push_back(Entry{offset, static_cast<uint32_t>(word.size()), codeLength, 0});
+    }
+    return assignCodes();
+}
+
+error_type CanonicalCode::assignCodes() {
+    // Number of codes of each length
+    std::vector<uint64_t> perLength(kMaxCodeLength + 1, 0);
+    maxLength_ = 0;
+    for (const Entry& entry : entries_) {
+        if (entry.codeLength < 1 || entry.codeLength > kMaxCodeLength) {
+            return CODE_TOO_LONG;
+        }
+        ++perLength[entry.codeLength];
+        maxLength_ = std::max(maxLength_, entry.codeLength);
+    }
+
+    // First code of each length (as in DEFLATE), checking the Kraft inequality
+    std::vector<uint64_t> next(kMaxCodeLength + 1, 0);
+    uint64_t code = 0;
+    bool full = false;   // every code of the current length is taken
+    for (int len = 1; len <= maxLength_; ++len) {
+        code = (code + perLength[len - 1]) << 1;
+        next[len] = code;
+        if (perLength[len] == 0) continue;
+        if (full) return INVALID_HEADER;
+
+        // Codes still free at this length; 2^64 - code for len 64 (0 meaning 2^64)
+        uint64_t left = len == 64 ? (code == 0 ? UINT64_MAX : 0 - code) : (1ULL << len) - code;
+        if (perLength[len] > left) return INVALID_HEADER;
+        full = perLength[len] == left;
+    }
+
+    // Entries are in lexicographic order, which is canonical order within a length
+    index_.clear();
+    index_.reserve(entries_.size());
+    for (size_t i = 0; i < entries_.size(); ++i) {
+        Entry& entry = entries_[i];
+        entry.code = next[entry.codeLength]++;
+        index_.emplace(words_.view(entry.offset, entry.length), static_cast<uint32_t>(i));
+    }
+    return NO_ERROR;
+}
+
+error_type CanonicalCode::writeHeader(std::ostream& os) const {
+    if (!os.good()) {
+        return UNABLE_TO_OPEN_FILE_FOR_WRITING;
+    }
+
+    os << "#canonical " << entries_.size() << '\n';
+    std::string_view previous;
+    for (size_t i = 0; i < entries_.size(); ++i) {
+        std::string_view word = wordAt(i);
+        size_t shared = 0;
+        size_t limit = std::min(previous.size(), word.size());
+        while (shared < limit && previous[shared] == word[shared]) {
+            ++shared;
+        }
+        os << shared << ' ' << word.substr(shared) << ' ' << entries_[i].codeLength << '\n';
+        previous = word;
+    }
+
+    if (!os) return FAILED_TO_WRITE_FILE;
+    return NO_ERROR;
+}
+
+error_type CanonicalCode::readHeader(std::istream& is) {
+    std::string line;
+    if (!std::getline(is, line)) {
+        return INVALID_HEADER;
+    }
+
+    std::istringstream first(line);
+    std::string magic;
+    size_t count = 0;
+    if (!(first >> magic >> count) || magic != "#canonical") {
+        return INVALID_HEADER;
+    }
+
+    words_.clear();
+    entries_.clear();
+    entries_.reserve(count);
+    std::string previous, word, suffix;
+    for (size_t i = 0; i < count; ++i) {
+        size_t shared;
+        int codeLength;
+        if (!(is >> shared >> suffix >> codeLength) || shared > previous.size()) {
+            return INVALID_HEADER;
+        }
+        word.assign(previous, 0, shared);
+        word += suffix;
+        if (i > 0 && !(previous < word)) {
+            return INVALID_HEADER;   // must be strictly lexicographic
+        }
+
+        size_t offset = words_.add(word);
+        entries_.push_back(Entry{offset, static_cast<uint32_t>(word.size()), codeLength, 0});
+        previous.swap(word);
+    }
+    return assignCodes();
+}
+
+void CanonicalCode::getCodebook(std::vector<std::pair<std::string, std::string>>& out) const {
+    out.clear();
+    out.reserve(entries_.size());
+    for (size_t i = 0; i < entries_.size(); ++i) {
+        const int length = entries_[i].codeLength;
+        std::string bits(length, '0');
+        for (int bit = 0; bit < length; ++bit) {
+            if ((entries_[i].code >> (length - 1 - bit)) & 1) bits[bit] = '1';
+        }
+        out.emplace_back(std::string(wordAt(i)), std::move(bits));
+    }
+}
+
+bool CanonicalCode::find(std::string_view word, uint64_t& code, int& length) const {
+    auto it = index_.find(word);
+    if (it == index_.end()) return false;
+    code = entries_[it->second].code;
+    length = entries_[it->second].codeLength;
+    return true;
+}
+
+error_type CanonicalCode::encode(const std::vector<std::string_view>& tokens,
+                                 std::ostream& os_bits,
+                                 int wrap_cols) const {
+    if (!os_bits.good()) {
+        return UNABLE_TO_OPEN_FILE_FOR_WRITING;
+    }
+
+    if (entries_.empty() || tokens.empty()) {
+        os_bits << '\n';
+        return NO_ERROR;
+    }
+
+    // Fill one output line at a time
+    std::string line;
+    line.reserve(wrap_cols + 1);
+    for (std::string_view token : tokens) {
+        uint64_t code;
+        int length;
+        if (!find(token, code, length)) {
+            std::cerr << "Error: Token '" << token << "' not found in codebook\n";
+            return FAILED_TO_WRITE_FILE;
+        }
+
+        for (int bit = length - 1; bit >= 0; --bit) {
+            line += ((code >> bit) & 1) ? '1' : '0';
+            if (static_cast<int>(line.size()) >= wrap_cols) {
+                line += '\n';
+                os_bits.write(line.data(), line.size());
+                line.clear();
+            }
+        }
+    }
+
+    // Write final newline if we haven't just written one
+    if (!line.empty()) {
+        line += '\n';
+        os_bits.write(line.data(), line.size());
+    }
+
+    if (!os_bits) return FAILED_TO_WRITE_FILE;
+    return NO_ERROR;
+}
+
+error_type CanonicalCode::encodeBinary(const std::vector<std::string_view>& tokens,
+                                       std::ostream& os_bits) const {
+    if (!os_bits.good()) {
+        return UNABLE_TO_OPEN_FILE_FOR_WRITING;
+    }
+
+    BitWriter writer(os_bits);
+    for (std::string_view token : tokens) {
+        uint64_t code;
+        int length;
+        if (!find(token, code, length)) {
+            std::cerr << "Error: Token '" << token << "' not found in codebook\n";
+            return FAILED_TO_WRITE_FILE;
+        }
+        writer.write(code, length);
+    }
+
+    return writer.finish();
+}
@@ -0,0 +1,79 @@
+#ifndef CANONICALCODE_HPP
+#define CANONICALCODE_HPP
+
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "utils.hpp"
+#include "StringArena.hpp"
+
+// Canonical Huffman code: only the code length of each word is kept. Codes
+// are assigned in (length, word) order, so the lengths alone determine them.
+//
+// Header format (text):
+//   #canonical <number of words>
+//   <shared prefix length> <suffix> <code length>      one line per word
+// Words are listed in lexicographic order and front-coded against the
+// previous word. Because canonical order within one length is lexicographic,
+// a reader assigns every code in a single pass over the lines.
+class CanonicalCode {
+public:
+    // Longest code this representation supports
+    static constexpr int kMaxCodeLength = 64;
+
+    CanonicalCode();
+
+    // Assign canonical codes from (word, code length) pairs in any order
+    error_type build(std::vector<std::pair<std::string, int>> lengths);
+
+    // Write / read the front-coded header described above
+    error_type writeHeader(std::ostream& os) const;
+    error_type readHeader(std::istream& is);
+
+    // Encode tokens as ASCII '0'/'1' wrapped at wrap_cols characters per line
+    // (same layout as HuffmanTree::encode)
+    error_type encode(const std::vector<std::string_view>& tokens,
+                      std::ostream& os_bits,
+                      int wrap_cols = 80) const;
+
+    // Encode tokens as a packed bitstream with a bit-count trailer (see BitWriter)
+    error_type encodeBinary(const std::vector<std::string_view>& tokens,
+                            std::ostream& os_bits) const;
+
+    // (word, '0'/'1' code) for every word, in lexicographic order
+    void getCodebook(std::vector<std::pair<std::string, std::string>>& out) const;
+
+    // Look up a word; false if it has no code
+    bool find(std::string_view word, uint64_t& code, int& length) const;
+
+    // Number of words and their (word, code length) in lexicographic order
+    size_t size() const { return entries_.size(); }
+    std::string_view wordAt(size_t i) const { return words_.view(entries_[i].offset, entries_[i].length); }
+    int codeLengthAt(size_t i) const { return entries_[i].codeLength; }
+    uint64_t codeAt(size_t i) const { return entries_[i].code; }
+    int maxCodeLength() const { return maxLength_; }
+
+private:
+    struct Entry {
+        size_t offset;      // word in words_
+        uint32_t length;
+        int codeLength;
+        uint64_t code;      // right-aligned, most significant bit first
+    };
+
+    // Assign codes to entries_ (already in lexicographic order)
+    error_type assignCodes();
+
+    StringArena words_;
+    std::vector<Entry> entries_;
+    std::unordered_map<std::string_view, uint32_t> index_;
+    int maxLength_;
+};
+
+#endif // CANONICALCODE_HPP
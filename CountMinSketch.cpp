@@ -0,0 +1,40 @@
+#include "CountMinSketch.hpp"
+#include "HashCounter.hpp"
+
+#include <algorithm>
+
+CountMinSketch::CountMinSketch(size_t width) {
+    size_t columns = 1;
+    while (columns < width) columns *= 2;
+    counters_.assign(kDepth * columns, 0);
+    mask_ = columns - 1;
+}
+
+// One independent-looking column per row: the word hash mixed with the row
+size_t CountMinSketch::column(uint64_t hash, size_t row) const {
+    return static_cast<size_t>(HashCounter::mixHash(hash, row)) & mask_;
+}
+
+uint64_t CountMinSketch::add(uint64_t hash) {
+    size_t at[kDepth];
+    uint32_t smallest = UINT32_MAX;
+    for (size_t row = 0; row < kDepth; ++row) {
+        at[row] = row * width() + column(hash, row);
+        smallest = std::min(smallest, counters_[at[row]]);
+    }
+    if (smallest == UINT32_MAX) return smallest;   // saturated
+
+    const uint32_t next = smallest + 1;
+    for (size_t row = 0; row < kDepth; ++row) {
+        counters_[at[row]] = std::max(counters_[at[row]], next);
+    }
+    return next;
+}
+
+uint64_t CountMinSketch::estimate(uint64_t hash) const {
+    uint32_t smallest = UINT32_MAX;
+    for (size_t row = 0; row < kDepth; ++row) {
+        smallest = std::min(smallest, counters_[row * width() + column(hash, row)]);
+    }
+    return smallest;
+}
@@ -0,0 +1,38 @@
+#ifndef COUNTMINSKETCH_HPP
+#define COUNTMINSKETCH_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// Count-Min sketch (Cormode and Muthukrishnan): kDepth rows of 'width'
+// counters. A word maps to one counter per row, chosen by its hash, and its
+// estimate is the smallest of them: never below its true count, and with
+// N words counted, more than 2N / width above it with probability at most
+// 2^-kDepth. Updates are conservative (only the counters at the estimate
+// go up), which keeps the overstatement smaller still.
+//
+// Memory is kDepth * width counters, whatever the number of distinct words.
+class CountMinSketch {
+public:
+    static constexpr size_t kDepth = 4;
+
+    // 'width' is rounded up to a power of two
+    explicit CountMinSketch(size_t width);
+
+    // Count one more occurrence of the word with 'hash' (HashCounter::hashWord)
+    // and return its new estimate
+    uint64_t add(uint64_t hash);
+
+    uint64_t estimate(uint64_t hash) const;
+
+    size_t width() const { return mask_ + 1; }
+
+private:
+    size_t column(uint64_t hash, size_t row) const;
+
+    std::vector<uint32_t> counters_;   // row after row
+    size_t mask_;
+};
+
+#endif // COUNTMINSKETCH_HPP
@@ -0,0 +1,126 @@
+#include "HashCounter.hpp"
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+HashCounter::HashCounter()
+    : slots_(1024, Slot{0, kEmpty, 0, 0}), size_(0), maxFreq_(0), maxProbe_(0) {}
+
+uint64_t HashCounter::hashWord(std::string_view word) {
+    // 8 bytes per step, multiply-xorshift mixing
+    const uint64_t mul = 0x9E3779B97F4A7C15ULL;
+    uint64_t h = word.size() * mul;
+    const char* p = word.data();
+    size_t n = word.size();
+
+    while (n >= 8) {
+        uint64_t chunk;
+        std::memcpy(&chunk, p, 8);
+        h = (h ^ chunk) * mul;
+        h ^= h >> 29;
+        p += 8;
+        n -= 8;
+    }
+    if (n > 0) {
+        uint64_t chunk = 0;
+        std::memcpy(&chunk, p, n);
+        h = (h ^ chunk) * mul;
+    }
+
+    h ^= h >> 32;
+    h *= 0xD6E8FEB86659FD93ULL;
+    h ^= h >> 32;
+    return h;
+}
+
+uint64_t HashCounter::mixHash(uint64_t hash, uint64_t seed) {
+    uint64_t h = hash + (seed + 1) * 0x9E3779B97F4A7C15ULL;
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDULL;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+void HashCounter::insert(std::string_view word, size_t count) {
+    // Keep the load factor at or below 1/2
+    if ((size_ + 1) * 2 > slots_.size()) {
+        grow();
+    }
+
+    const uint64_t hash = hashWord(word);
+    const size_t mask = slots_.size() - 1;
+    size_t index = hash & mask;
+    int probes = 1;
+
+    while (slots_[index].offset != kEmpty) {
+        Slot& slot = slots_[index];
+        if (slot.hash == hash && slot.length == word.size() &&
+            keys_.view(slot.offset, slot.length) == word) {
+            slot.count += count;
+            maxFreq_ = std::max<size_t>(maxFreq_, slot.count);
+            return;
+        }
+        index = (index + 1) & mask;
+        ++probes;
+    }
+
+    slots_[index] = Slot{hash, keys_.add(word), count, static_cast<uint32_t>(word.size())};
+    ++size_;
+    maxFreq_ = std::max(maxFreq_, count);
+    maxProbe_ = std::max(maxProbe_, probes);
+}
+
+void HashCounter::grow() {
+    std::vector<Slot> old(slots_.size() * 2, Slot{0, kEmpty, 0, 0});
+    old.swap(slots_);
+
+    // Re-place every slot using its stored hash; keys stay where they are
+    const size_t mask = slots_.size() - 1;
+    maxProbe_ = 0;
+    for (const Slot& slot : old) {
+        if (slot.offset == kEmpty) continue;
+        size_t index = slot.hash & mask;
+        int probes = 1;
+        while (slots_[index].offset != kEmpty) {
+            index = (index + 1) & mask;
+            ++probes;
+        }
+        slots_[index] = slot;
+        maxProbe_ = std::max(maxProbe_, probes);
+    }
+}
+
+std::vector<std::pair<std::string, size_t>> HashCounter::getFrequencies() const {
+    std::vector<const Slot*> used;
+    used.reserve(size_);
+    for (const Slot& slot : slots_) {
+        if (slot.offset != kEmpty) used.push_back(&slot);
+    }
+
+    std::sort(used.begin(), used.end(), [this](const Slot* a, const Slot* b) {
+        return keys_.view(a->offset, a->length) < keys_.view(b->offset, b->length);
+    });
+
+    std::vector<std::pair<std::string, size_t>> result;
+    result.reserve(used.size());
+    for (const Slot* slot : used) {
+        result.emplace_back(std::string(keys_.view(slot->offset, slot->length)), slot->count);
+    }
+    return result;
+}
+
+void HashCounter::getMinMaxFrequency(size_t& minFreq, size_t& maxFreq) const {
+    if (size_ == 0) {
+        minFreq = 0;
+        maxFreq = 0;
+        return;
+    }
+
+    minFreq = std::numeric_limits<size_t>::max();
+    for (const Slot& slot : slots_) {
+        if (slot.offset != kEmpty) minFreq = std::min<size_t>(minFreq, slot.count);
+    }
+    maxFreq = maxFreq_;
+}
@@ -0,0 +1,64 @@
+#ifndef HASHCOUNTER_HPP
+#define HASHCOUNTER_HPP
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "StringArena.hpp"
+
+// Word-frequency table using open addressing (linear probing).
+// Each slot keeps the word's full 64-bit hash, so probes compare hashes before
+// touching the key bytes and growing the table never rehashes a string. Keys
+// live back to back in a StringArena. Lexicographic order is produced once,
+// by sorting, when getFrequencies() is called.
+class HashCounter {
+public:
+    HashCounter();
+
+    // Insert a word with 'count' occurrences (or add to its count if it exists)
+    void insert(std::string_view word, size_t count = 1);
+
+    // Number of distinct words
+    size_t size() const { return size_; }
+
+    bool isEmpty() const { return size_ == 0; }
+
+    // All (word, count) pairs in lexicographic order
+    std::vector<std::pair<std::string, size_t>> getFrequencies() const;
+
+    // Min and max counts (0, 0 when empty)
+    void getMinMaxFrequency(size_t& minFreq, size_t& maxFreq) const;
+
+    // Longest probe sequence any insert has needed (1 = no collisions)
+    int getMaxProbeLength() const { return maxProbe_; }
+
+    // 64-bit hash of a word (also used by TokenInterner)
+    static uint64_t hashWord(std::string_view word);
+
+    // A seeded remix of a word hash (murmur3 finalizer), for structures
+    // that need several independent-looking hashes of one word
+    static uint64_t mixHash(uint64_t hash, uint64_t seed);
+
+private:
+    static constexpr uint64_t kEmpty = UINT64_MAX;
+
+    struct Slot {
+        uint64_t hash;
+        uint64_t offset;   // kEmpty for an unused slot
+        uint64_t count;
+        uint32_t length;
+    };
+
+    void grow();
+
+    std::vector<Slot> slots_;   // capacity is a power of two
+    StringArena keys_;
+    size_t size_;
+    size_t maxFreq_;
+    int maxProbe_;
+};
+
+#endif // HASHCOUNTER_HPP
@@ -0,0 +1,340 @@
+#include "HuffmanDecoder.hpp"
+#include "BitWriter.hpp"
+#include "CanonicalCode.hpp"
+#include "MappedFile.hpp"
+#include "Threads.hpp"
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+
+HuffmanDecoder::HuffmanDecoder() : primaryBits_(0) {}
+
+uint32_t HuffmanDecoder::addSymbol(std::string_view word) {
+    symbols_.emplace_back(words_.add(word), static_cast<uint32_t>(word.size()));
+    return static_cast<uint32_t>(symbols_.size() - 1);
+}
+
+error_type HuffmanDecoder::readHeader(std::istream& is) {
+    words_.clear();
+    symbols_.clear();
+    views_.clear();
+    table_.clear();
+    primaryBits_ = 0;
+
+    std::vector<std::pair<std::string, std::string>> codebook;
+    if (error_type status = readCodebook(is, codebook); status != NO_ERROR) {
+        return status;
+    }
+
+    std::vector<Code> codes;
+    codes.reserve(codebook.size());
+    for (auto& [word, bits] : codebook) {
+        codes.push_back(Code{std::move(bits), addSymbol(word)});
+    }
+
+    views_.reserve(symbols_.size());
+    for (const auto& [offset, length] : symbols_) {
+        views_.push_back(words_.view(offset, length));
+    }
+    return buildTables(codes);
+}
+
+error_type HuffmanDecoder::readCodebook(std::istream& is,
+                                        std::vector<std::pair<std::string, std::string>>& codebook) {
+    // Words never contain '#', so the canonical magic cannot be a tree line
+    if (is.peek() == '#') {
+        CanonicalCode canonical;
+        if (error_type status = canonical.readHeader(is); status != NO_ERROR) {
+            return status;
+        }
+        canonical.getCodebook(codebook);
+        return NO_ERROR;
+    }
+
+    std::string line, word, bits;
+    while (std::getline(is, line)) {
+        if (line.empty()) continue;
+        std::istringstream fields(line);
+        if (!(fields >> word >> bits) || bits.find_first_not_of("01") != std::string::npos) {
+            return INVALID_HEADER;
+        }
+        codebook.emplace_back(word, bits);
+    }
+    return NO_ERROR;
+}
+
+// Read 'count' bits of 'bits' starting at 'pos' as an integer
+static uint32_t bitsToIndex(const std::string& bits, size_t pos, size_t count) {
+    uint32_t index = 0;
+    for (size_t i = pos; i < pos + count; ++i) {
+        index = (index << 1) | (bits[i] == '1');
+    }
+    return index;
+}
+
+error_type HuffmanDecoder::buildTables(std::vector<Code>& codes) {
+    if (codes.empty()) return NO_ERROR;
+
+    // Sorting the bit strings puts every prefix right before the codes that
+    // extend it, so each (sub)table covers one contiguous range of codes
+    std::sort(codes.begin(), codes.end(), [](const Code& a, const Code& b) { return a.bits < b.bits; });
+
+    size_t maxLength = 0;
+    for (const Code& code : codes) {
+        if (code.bits.empty()) return INVALID_HEADER;
+        maxLength = std::max(maxLength, code.bits.size());
+    }
+
+    primaryBits_ = static_cast<int>(std::min<size_t>(kPrimaryBits, maxLength));
+    table_.assign(size_t(1) << primaryBits_, Entry{0, 0, kInvalid});
+    return buildTable(codes, 0, codes.size(), 0, primaryBits_, 0);
+}
+
+// Fill the table at 'start', indexed by 'width' bits after the first 'depth'
+// bits, from codes[lo, hi) (which all share those first 'depth' bits)
+error_type HuffmanDecoder::buildTable(const std::vector<Code>& codes, size_t lo, size_t hi,
+                                      size_t depth, int width, size_t start) {
+    size_t i = lo;
+    while (i < hi) {
+        const std::string& bits = codes[i].bits;
+        const size_t remaining = bits.size() - depth;
+
+        if (remaining <= static_cast<size_t>(width)) {
+            // Short code: fill every slot that starts with it
+            if (i + 1 < hi && codes[i + 1].bits.compare(0, bits.size(), bits) == 0) {
+                return INVALID_HEADER;   // a code is a prefix of another (or repeated)
+            }
+            const size_t shift = width - remaining;
+            const size_t first = static_cast<size_t>(bitsToIndex(bits, depth, remaining)) << shift;
+            std::fill_n(table_.begin() + start + first, size_t(1) << shift,
+                        Entry{codes[i].symbol, static_cast<uint8_t>(remaining), kSymbol});
+            ++i;
+            continue;
+        }
+
+        // Long codes sharing the next 'width' bits go to one secondary table
+        size_t j = i + 1;
+        size_t maxLength = bits.size();
+        while (j < hi && codes[j].bits.size() > depth + width &&
+               codes[j].bits.compare(depth, width, bits, depth, width) == 0) {
+            maxLength = std::max(maxLength, codes[j].bits.size());
+            ++j;
+        }
+
+        const int subWidth = static_cast<int>(std::min<size_t>(kPrimaryBits, maxLength - depth - width));
+        const size_t subStart = table_.size();
+        table_.resize(subStart + (size_t(1) << subWidth), Entry{0, 0, kInvalid});
+        table_[start + bitsToIndex(bits, depth, width)] =
+            Entry{static_cast<uint32_t>(subStart), static_cast<uint8_t>(subWidth), kTable};
+
+        if (error_type status = buildTable(codes, i, j, depth + width, subWidth, subStart);
+            status != NO_ERROR) {
+            return status;
+        }
+        i = j;
+    }
+    return NO_ERROR;
+}
+
+// The 64 bits starting at bit 'pos', zero past the end of the data
+static inline uint64_t peekBits(const unsigned char* data, size_t size, uint64_t pos) {
+    const size_t byte = pos >> 3;
+    uint64_t window = 0;
+    if (byte + 8 <= size) {
+        std::memcpy(&window, data + byte, 8);
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+        window = __builtin_bswap64(window);
+#endif
+    } else {
+        for (size_t k = byte; k < byte + 8; ++k) {
+            window = (window << 8) | (k < size ? data[k] : 0);
+        }
+    }
+    return window << (pos & 7);
+}
+
+error_type HuffmanDecoder::decodeSymbol(const unsigned char* data, size_t size, uint64_t& pos,
+                                        uint32_t& symbol) const {
+    // Each probe uses at most kPrimaryBits bits, well inside one window
+    const Entry* table = table_.data();
+    const Entry* level = table;
+    int width = primaryBits_;
+    uint64_t window = peekBits(data, size, pos);
+    int used = 0;
+    for (;;) {
+        const Entry entry = level[(window << used) >> (64 - width)];
+        if (entry.kind == kSymbol) {
+            pos += entry.bits;
+            symbol = entry.value;
+            return NO_ERROR;
+        }
+        if (entry.kind != kTable) return INVALID_CODE;
+
+        pos += width;
+        used += width;
+        level = table + entry.value;
+        width = entry.bits;
+        if (used + width > 64 - 7) {
+            window = peekBits(data, size, pos);
+            used = 0;
+        }
+    }
+}
+
+error_type HuffmanDecoder::decode(const unsigned char* data, size_t size, uint64_t bitCount,
+                                  std::vector<std::string_view>& tokens) const {
+    if (bitCount > uint64_t(size) * 8) return INVALID_CODE;
+    if (bitCount == 0) return NO_ERROR;
+    if (table_.empty()) return INVALID_CODE;
+
+    uint64_t pos = 0;
+    while (pos < bitCount) {
+        uint32_t symbol;
+        if (error_type status = decodeSymbol(data, size, pos, symbol); status != NO_ERROR) {
+            return status;
+        }
+        tokens.push_back(views_[symbol]);
+    }
+
+    // The last code must end exactly at the last real bit
+    return pos == bitCount ? NO_ERROR : INVALID_CODE;
+}
+
+error_type HuffmanDecoder::decodeBlocks(const unsigned char* data, const BlockIndex& index,
+                                        size_t firstBlock, size_t lastBlock, unsigned threads,
+                                        std::vector<std::string_view>& tokens) const {
+    // Contiguous runs of blocks per thread, joined in order afterwards
+    const size_t blocks = lastBlock - firstBlock;
+    const size_t workers = std::max<size_t>(1, std::min<size_t>(threads, blocks));
+    std::vector<std::vector<std::string_view>> parts(workers);
+    std::vector<error_type> status(workers, NO_ERROR);
+
+    runOnThreads(workers, [&](size_t w) {
+        const size_t begin = firstBlock + blocks * w / workers;
+        const size_t end = firstBlock + blocks * (w + 1) / workers;
+        for (size_t b = begin; b < end && status[w] == NO_ERROR; ++b) {
+            const BlockEntry& block = index.blocks[b];
+            const unsigned char* bytes = data + block.bitOffset / 8;
+            const size_t size = static_cast<size_t>((block.bitCount + 7) / 8);
+            const size_t before = parts[w].size();
+            if (BlockIndex::crc32(bytes, size) != block.crc) {
+                status[w] = INVALID_CODE;
+            } else {
+                status[w] = decode(bytes, size, block.bitCount, parts[w]);
+            }
+            if (status[w] == NO_ERROR && parts[w].size() - before != block.tokenCount) {
+                status[w] = INVALID_CODE;
+            }
+        }
+    });
+
+    for (size_t w = 0; w < workers; ++w) {
+        if (status[w] != NO_ERROR) return status[w];
+        tokens.insert(tokens.end(), parts[w].begin(), parts[w].end());
+    }
+    return NO_ERROR;
+}
+
+error_type HuffmanDecoder::decodeFile(const std::string& codeFileName,
+                                      std::vector<std::string_view>& tokens,
+                                      unsigned threads) const {
+    MappedFile file;
+    if (error_type status = file.open(codeFileName); status != NO_ERROR) {
+        return status;
+    }
+    const auto* data = reinterpret_cast<const unsigned char*>(file.data());
+    const size_t size = file.size();
+
+    // Container: independently decodable blocks listed in a trailing index
+    if (BlockIndex::isContainer(data, size)) {
+        BlockIndex index;
+        if (error_type status = index.read(data, size); status != NO_ERROR) {
+            return status;
+        }
+        tokens.reserve(tokens.size() + index.totalTokens());
+        return decodeBlocks(data, index, 0, index.blocks.size(), threads, tokens);
+    }
+
+    std::vector<unsigned char> packed;
+    const unsigned char* bits = nullptr;
+    size_t bytes = 0;
+    uint64_t bitCount = 0;
+    if (error_type status = unpackCode(data, size, packed, bits, bytes, bitCount); status != NO_ERROR) {
+        return status;
+    }
+    return decode(bits, bytes, bitCount, tokens);
+}
+
+error_type HuffmanDecoder::unpackCode(const unsigned char* data, size_t size,
+                                      std::vector<unsigned char>& packed,
+                                      const unsigned char*& bits, size_t& bytes, uint64_t& bitCount) {
+    // Binary: payload, then <bit count, 8 bytes LE> "HFB1"
+    if (size >= BitWriter::kTrailerBytes &&
+        std::memcmp(data + size - sizeof(BitWriter::kMagic), BitWriter::kMagic, sizeof(BitWriter::kMagic)) == 0) {
+        const unsigned char* trailer = data + size - BitWriter::kTrailerBytes;
+        bitCount = 0;
+        for (int i = 7; i >= 0; --i) {
+            bitCount = (bitCount << 8) | trailer[i];
+        }
+        const size_t payload = size - BitWriter::kTrailerBytes;
+        if (payload != (bitCount + 7) / 8) return INVALID_CODE;
+        bits = data;
+        bytes = payload;
+        return NO_ERROR;
+    }
+
+    // ASCII: pack the '0'/'1' characters, ignoring line breaks
+    packed.assign((size + 7) / 8, 0);
+    bitCount = 0;
+    for (size_t i = 0; i < size; ++i) {
+        const unsigned char c = data[i];
+        if (c == '0' || c == '1') {
+            packed[bitCount >> 3] |= static_cast<unsigned char>((c - '0') << (7 - (bitCount & 7)));
+            ++bitCount;
+        } else if (c != '\n' && c != '\r') {
+            return INVALID_CODE;
+        }
+    }
+    bits = packed.data();
+    bytes = packed.size();
+    return NO_ERROR;
+}
+
+error_type HuffmanDecoder::decodeRange(const std::string& codeFileName, uint64_t first, uint64_t count,
+                                       std::vector<std::string_view>& tokens) const {
+    MappedFile file;
+    if (error_type status = file.open(codeFileName); status != NO_ERROR) {
+        return status;
+    }
+    const auto* data = reinterpret_cast<const unsigned char*>(file.data());
+    const size_t size = file.size();
+
+    std::vector<std::string_view> decoded;
+    uint64_t skip = first;
+    if (BlockIndex::isContainer(data, size)) {
+        BlockIndex index;
+        if (error_type status = index.read(data, size); status != NO_ERROR) {
+            return status;
+        }
+        const uint64_t last = std::min(index.totalTokens(), first + std::min(count, UINT64_MAX - first));
+        if (first >= last) return NO_ERROR;
+
+        const size_t firstBlock = index.blockOf(first);
+        const size_t lastBlock = index.blockOf(last - 1) + 1;
+        if (error_type status = decodeBlocks(data, index, firstBlock, lastBlock, 1, decoded);
+            status != NO_ERROR) {
+            return status;
+        }
+        skip = first - index.blocks[firstBlock].firstToken;
+    } else {
+        file.close();
+        if (error_type status = decodeFile(codeFileName, decoded); status != NO_ERROR) {
+            return status;
+        }
+    }
+
+    if (skip >= decoded.size()) return NO_ERROR;
+    const size_t take = static_cast<size_t>(std::min<uint64_t>(count, decoded.size() - skip));
+    tokens.insert(tokens.end(), decoded.begin() + skip, decoded.begin() + skip + take);
+    return NO_ERROR;
+}
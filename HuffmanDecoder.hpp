@@ -0,0 +1,105 @@
+#ifndef HUFFMANDECODER_HPP
+#define HUFFMANDECODER_HPP
+
+#include <cstdint>
+#include <istream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "utils.hpp"
+#include "StringArena.hpp"
+#include "BlockIndex.hpp"
+
+// Decodes a .code file back into tokens using the matching .hdr.
+//
+// Both header formats are accepted: the pre-order "word code" lines written
+// by HuffmanTree and the "#canonical" header written by CanonicalCode. Every
+// .code format is accepted too: ASCII '0'/'1' lines, the packed binary
+// stream written by BitWriter, and the block container (see BlockIndex.hpp);
+// the binary formats are recognised by their trailers.
+//
+// Decoding is table driven: the next kPrimaryBits bits index a primary
+// table, which resolves every code up to that length in one probe. Longer
+// codes continue into secondary tables indexed by the following bits, sized
+// to the longest code below each prefix, so codes of any length decode.
+class HuffmanDecoder {
+public:
+    // Bits resolved by one table probe
+    static constexpr int kPrimaryBits = 11;
+
+    HuffmanDecoder();
+
+    // Load either header format and build the lookup tables
+    error_type readHeader(std::istream& is);
+
+    // The (word, '0'/'1' code) pairs of either header format, in header order
+    static error_type readCodebook(std::istream& is,
+                                   std::vector<std::pair<std::string, std::string>>& codebook);
+
+    // Decode a whole .code file (format detected automatically). Blocks of
+    // a container are checked against their CRC and split over 'threads'.
+    // The views point into this decoder and stay valid while it lives.
+    error_type decodeFile(const std::string& codeFileName,
+                          std::vector<std::string_view>& tokens,
+                          unsigned threads = 1) const;
+
+    // Decode tokens [first, first + count) only (clamped to the end). In a
+    // container only the blocks holding them are read; other formats are
+    // decoded from the start.
+    error_type decodeRange(const std::string& codeFileName, uint64_t first, uint64_t count,
+                           std::vector<std::string_view>& tokens) const;
+
+    // Decode 'bitCount' bits packed most significant bit first
+    error_type decode(const unsigned char* data, size_t size, uint64_t bitCount,
+                      std::vector<std::string_view>& tokens) const;
+
+    // Decode the one code starting at bit 'pos' (of 'size' bytes) into its
+    // symbol index and advance 'pos' past it. Lets a caller switch between
+    // several codes within one stream (see SharedDictionary).
+    error_type decodeSymbol(const unsigned char* data, size_t size, uint64_t& pos,
+                            uint32_t& symbol) const;
+
+    // The packed code bits of a binary or ASCII .code file: 'bits' points into
+    // 'data' (binary) or into 'packed' (ASCII, packed here)
+    static error_type unpackCode(const unsigned char* data, size_t size,
+                                 std::vector<unsigned char>& packed,
+                                 const unsigned char*& bits, size_t& bytes, uint64_t& bitCount);
+
+    // Number of words in the loaded header, and the word of a symbol index
+    size_t size() const { return symbols_.size(); }
+    std::string_view symbol(uint32_t index) const { return views_[index]; }
+
+private:
+    enum entry_kind : uint8_t { kInvalid, kSymbol, kTable };
+
+    // One table slot: a symbol and the bits its code uses at this level,
+    // or the start and index width of the next table
+    struct Entry {
+        uint32_t value;
+        uint8_t bits;
+        entry_kind kind;
+    };
+
+    struct Code {
+        std::string bits;   // '0'/'1'
+        uint32_t symbol;
+    };
+
+    uint32_t addSymbol(std::string_view word);
+    error_type decodeBlocks(const unsigned char* data, const BlockIndex& index,
+                            size_t firstBlock, size_t lastBlock, unsigned threads,
+                            std::vector<std::string_view>& tokens) const;
+    error_type buildTables(std::vector<Code>& codes);
+    error_type buildTable(const std::vector<Code>& codes, size_t lo, size_t hi,
+                          size_t depth, int width, size_t start);
+
+    StringArena words_;
+    std::vector<std::pair<size_t, uint32_t>> symbols_;   // (offset, length) in words_
+    std::vector<std::string_view> views_;                // filled once the header is read
+    std::vector<Entry> table_;                           // primary table first
+    int primaryBits_;
+};
+
+#endif // HUFFMANDECODER_HPP
@@ -1,4 +1,5 @@
 #include "HuffmanTree.hpp"
+#include "TokenEncoder.hpp"
 #include <algorithm>
 #include <map>
 #include <iostream>
@@ -7,104 +8,318 @@
 // NEW FILE FOR PHASE 3: HuffmanTree implementation
 // ============================================================================
 
-HuffmanTree::HuffmanTree() : root_(nullptr) {}
+HuffmanTree::HuffmanTree() : nodes_(1, TreeNode{0, 0, 0, kNil, kNil}), root_(kNil) {}
 
-HuffmanTree::~HuffmanTree() {
-    destroy(root_);
+// The node pool and the word arena are each released with one deallocation
+HuffmanTree::~HuffmanTree() = default;
+
+HuffmanTree::Index HuffmanTree::newLeaf(const std::string& word, size_t frequency) {
+    const size_t offset = words_.add(word);
+    nodes_.push_back(TreeNode{frequency, offset, static_cast<uint32_t>(word.size()), kNil, kNil});
+    return static_cast<Index>(nodes_.size() - 1);
+}
+
+HuffmanTree::Index HuffmanTree::newInternal(Index left, Index right) {
+    const size_t frequency = nodes_[left].frequency + nodes_[right].frequency;
+    nodes_.push_back(TreeNode{frequency, 0, 0, left, right});
+    return static_cast<Index>(nodes_.size() - 1);
 }
 
-void HuffmanTree::destroy(TreeNode* node) {
-    if (node == nullptr) return;
-    destroy(node->left);
-    destroy(node->right);
-    delete node;
+std::string_view HuffmanTree::wordOf(Index node) const {
+    return words_.view(nodes_[node].wordOffset, nodes_[node].wordLength);
 }
 
 void HuffmanTree::buildFromFrequencies(const std::vector<std::pair<std::string, size_t>>& freqs) {
+    nodes_.resize(1);
+    words_.clear();
+    root_ = kNil;
+
     if (freqs.empty()) {
-        root_ = nullptr;
         return;
     }
     
+    // A tree with n leaves has 2n - 1 nodes: size the pool once
+    nodes_.reserve(2 * freqs.size());
+
     // Special case: single word
     if (freqs.size() == 1) {
-        root_ = new TreeNode(freqs[0].first, freqs[0].second);
+        root_ = newLeaf(freqs[0].first, freqs[0].second);
         return;
     }
     
-    // Create a working copy sorted by frequency (smallest first, then lexicographically)
-    // The input is sorted descending, so we reverse it
-    std::vector<TreeNode*> nodes;
+    // Leaves in reverse input order: ascending frequency when the input
+    // follows the documented (count descending) order
+    std::vector<Index> leaves;
+    leaves.reserve(freqs.size());
     for (auto it = freqs.rbegin(); it != freqs.rend(); ++it) {
-        nodes.push_back(new TreeNode(it->first, it->second));
+        leaves.push_back(newLeaf(it->first, it->second));
     }
-    
-    // Build Huffman tree using greedy algorithm
-    while (nodes.size() > 1) {
-        // Take two nodes with smallest frequency (at the beginning)
-        TreeNode* left = nodes[0];
-        TreeNode* right = nodes[1];
-        nodes.erase(nodes.begin(), nodes.begin() + 2);
-        
-        // Create parent node
-        TreeNode* parent = new TreeNode(left, right);
-        
-        // Insert parent back maintaining sorted order
-        // Find insertion point to keep sorted by frequency (ascending)
-        auto insertPos = std::lower_bound(nodes.begin(), nodes.end(), parent,
-            [](const TreeNode* a, const TreeNode* b) {
-                if (a->frequency != b->frequency) {
-                    return a->frequency < b->frequency;
-                }
-                // For tie-breaking, prefer the node that was created earlier
-                // (this gives deterministic behavior)
-                return false;
-            });
-        nodes.insert(insertPos, parent);
+
+    auto ascending = [this](Index a, Index b) { return nodes_[a].frequency <= nodes_[b].frequency; };
+    bool sorted = std::adjacent_find(leaves.begin(), leaves.end(),
+                                     [&](Index a, Index b) { return !ascending(a, b); }) == leaves.end();
+
+    root_ = sorted ? buildTwoQueue(leaves) : buildReplay(leaves);
+}
+
+// Both builders reproduce the original construction, which kept one working
+// list, removed its first two nodes, and re-inserted their parent with
+// std::lower_bound by frequency (i.e. before every node of equal frequency).
+// That tie-breaking decides the codes, so it must not change.
+
+HuffmanTree::Index HuffmanTree::buildTwoQueue(const std::vector<Index>& leaves) {
+    // Sorted input: the working list is always sorted, parents are created
+    // in non-decreasing frequency order, and among equal frequencies the
+    // newest parent comes first, then the older parents, then the leaves.
+    // Leaves form one queue; parents form a queue of equal-frequency groups,
+    // each group popped newest-first. O(n) overall.
+    struct Group {
+        size_t frequency;
+        size_t begin;
+        size_t end;
+    };
+    std::vector<Index> parents;
+    std::vector<Group> groups;
+    parents.reserve(leaves.size());
+    size_t nextLeaf = 0;
+    size_t nextGroup = 0;
+
+    auto popMin = [&]() -> Index {
+        bool haveParent = nextGroup < groups.size();
+        bool haveLeaf = nextLeaf < leaves.size();
+        if (haveParent && (!haveLeaf || groups[nextGroup].frequency <= nodes_[leaves[nextLeaf]].frequency)) {
+            Group& group = groups[nextGroup];
+            Index node = parents[--group.end];
+            if (nextGroup + 1 == groups.size()) {
+                parents.pop_back();   // keep the last group at the end of 'parents'
+            }
+            if (group.end == group.begin) {
+                ++nextGroup;
+            }
+            return node;
+        }
+        return leaves[nextLeaf++];
+    };
+
+    size_t remaining = leaves.size();
+    while (remaining > 1) {
+        Index left = popMin();
+        Index right = popMin();
+        Index parent = newInternal(left, right);
+        size_t frequency = nodes_[parent].frequency;
+
+        if (nextGroup < groups.size() && groups.back().frequency == frequency) {
+            parents.push_back(parent);
+            groups.back().end = parents.size();
+        } else {
+            groups.push_back(Group{frequency, parents.size(), parents.size() + 1});
+            parents.push_back(parent);
+        }
+        --remaining;
     }
-    
-    root_ = nodes[0];
+    return popMin();
+}
+
+namespace {
+
+// Sequence with O(log n) positional access and O(B + log n) insertion:
+// values are kept in blocks of at most 2B, and a Fenwick tree over the block
+// sizes maps a position to its block. Used to replay the list-based
+// construction on unsorted input.
+class IndexedSequence {
+public:
+    explicit IndexedSequence(const std::vector<uint32_t>& values) {
+        for (size_t i = 0; i < values.size(); i += kBlock) {
+            size_t end = std::min(values.size(), i + kBlock);
+            blocks_.emplace_back(values.begin() + i, values.begin() + end);
+        }
+        if (blocks_.empty()) blocks_.emplace_back();
+        rebuildIndex();
+    }
+
+    size_t size() const { return size_; }
+
+    uint32_t at(size_t position) const {
+        size_t offset = position;
+        size_t block = find(offset);
+        return blocks_[block][offset];
+    }
+
+    void insert(size_t position, uint32_t value) {
+        size_t block, offset = position;
+        if (position == size_) {
+            block = blocks_.size() - 1;
+            offset = blocks_[block].size();
+        } else {
+            block = find(offset);
+        }
+
+        auto& values = blocks_[block];
+        values.insert(values.begin() + offset, value);
+        ++size_;
+        add(block, 1);
+
+        if (values.size() >= 2 * kBlock) {
+            std::vector<uint32_t> upper(values.begin() + kBlock, values.end());
+            values.resize(kBlock);
+            blocks_.insert(blocks_.begin() + block + 1, std::move(upper));
+            rebuildIndex();
+        }
+    }
+
+    // Remove the first 'count' values
+    void eraseFront(size_t count) {
+        while (count > 0) {
+            auto& values = blocks_[front_];
+            size_t take = std::min(count, values.size());
+            values.erase(values.begin(), values.begin() + take);
+            add(front_, -static_cast<long>(take));
+            size_ -= take;
+            count -= take;
+            if (values.empty() && front_ + 1 < blocks_.size()) ++front_;
+        }
+    }
+
+private:
+    static constexpr size_t kBlock = 256;
+
+    void rebuildIndex() {
+        tree_.assign(blocks_.size() + 1, 0);
+        size_ = 0;
+        front_ = 0;
+        for (size_t i = 0; i < blocks_.size(); ++i) {
+            size_ += blocks_[i].size();
+            if (blocks_[i].empty() && front_ == i && i + 1 < blocks_.size()) ++front_;
+            tree_[i + 1] += blocks_[i].size();
+            size_t parent = (i + 1) + ((i + 1) & -(i + 1));
+            if (parent < tree_.size()) tree_[parent] += tree_[i + 1];
+        }
+        topBit_ = 1;
+        while (topBit_ * 2 < tree_.size()) topBit_ *= 2;
+    }
+
+    void add(size_t block, long delta) {
+        for (size_t i = block + 1; i < tree_.size(); i += i & -i) {
+            tree_[i] += delta;
+        }
+    }
+
+    // Block holding 'position'; 'position' becomes the offset inside it
+    size_t find(size_t& position) const {
+        size_t block = 0;
+        for (size_t bit = topBit_; bit > 0; bit >>= 1) {
+            size_t next = block + bit;
+            if (next < tree_.size() && tree_[next] <= position) {
+                block = next;
+                position -= tree_[next];
+            }
+        }
+        return block;
+    }
+
+    std::vector<std::vector<uint32_t>> blocks_;
+    std::vector<size_t> tree_;   // Fenwick tree of block sizes, 1-based
+    size_t topBit_ = 1;
+    size_t size_ = 0;
+    size_t front_ = 0;           // first block that may be non-empty
+};
+
+} // namespace
+
+HuffmanTree::Index HuffmanTree::buildReplay(const std::vector<Index>& leaves) {
+    // Unsorted input: the working list is not sorted, so std::lower_bound's
+    // exact probe sequence determines where each parent lands. Replay it on
+    // an indexed sequence: O(log^2 n + B) per merge instead of the O(n) shifts
+    // of erasing from and inserting into a vector.
+    IndexedSequence list(leaves);
+
+    while (list.size() > 1) {
+        Index left = list.at(0);
+        Index right = list.at(1);
+        list.eraseFront(2);
+        Index parent = newInternal(left, right);
+        size_t frequency = nodes_[parent].frequency;
+
+        // Same probes as std::lower_bound(begin, end, parent, frequency <)
+        size_t first = 0;
+        size_t count = list.size();
+        while (count > 0) {
+            size_t step = count / 2;
+            if (nodes_[list.at(first + step)].frequency < frequency) {
+                first += step + 1;
+                count -= step + 1;
+            } else {
+                count = step;
+            }
+        }
+        list.insert(first, parent);
+    }
+    return list.at(0);
 }
 
 int HuffmanTree::getHeight() const {
     return height(root_);
 }
 
-int HuffmanTree::height(TreeNode* node) const {
-    if (node == nullptr) return 0;
-    if (node->isLeaf()) return 1;
+int HuffmanTree::height(Index node) const {
+    if (node == kNil) return 0;
+    if (isLeaf(node)) return 1;
     
-    int leftHeight = height(node->left);
-    int rightHeight = height(node->right);
+    int leftHeight = height(nodes_[node].left);
+    int rightHeight = height(nodes_[node].right);
     
     return 1 + std::max(leftHeight, rightHeight);
 }
 
 void HuffmanTree::assignCodes(std::vector<std::pair<std::string, std::string>>& out) const {
     out.clear();
-    if (root_ == nullptr) return;
+    if (root_ == kNil) return;
     
     // Special case: single word gets code "0"
-    if (root_->isLeaf()) {
-        out.push_back({root_->word, "0"});
+    if (isLeaf(root_)) {
+        out.push_back({std::string(wordOf(root_)), "0"});
         return;
     }
     
     assignCodesDFS(root_, "", out);
 }
 
-void HuffmanTree::assignCodesDFS(TreeNode* node, const std::string& code,
+void HuffmanTree::getCodeLengths(std::vector<std::pair<std::string, int>>& out) const {
+    out.clear();
+    if (root_ == kNil) return;
+
+    if (isLeaf(root_)) {
+        out.push_back({std::string(wordOf(root_)), 1});
+        return;
+    }
+
+    // Pre-order walk with an explicit (node, depth) stack; right is pushed
+    // first so that left is visited first
+    std::vector<std::pair<Index, int>> stack{{root_, 0}};
+    while (!stack.empty()) {
+        auto [node, depth] = stack.back();
+        stack.pop_back();
+        if (isLeaf(node)) {
+            out.push_back({std::string(wordOf(node)), depth});
+            continue;
+        }
+        if (nodes_[node].right) stack.push_back({nodes_[node].right, depth + 1});
+        if (nodes_[node].left) stack.push_back({nodes_[node].left, depth + 1});
+    }
+}
+
+void HuffmanTree::assignCodesDFS(Index node, const std::string& code,
                                   std::vector<std::pair<std::string, std::string>>& out) const {
-    if (node == nullptr) return;
+    if (node == kNil) return;
     
-    if (node->isLeaf()) {
-        out.push_back({node->word, code});
+    if (isLeaf(node)) {
+        out.push_back({std::string(wordOf(node)), code});
         return;
     }
     
     // Traverse left (add '0') before right (add '1')
-    if (node->left) assignCodesDFS(node->left, code + "0", out);
-    if (node->right) assignCodesDFS(node->right, code + "1", out);
+    if (nodes_[node].left) assignCodesDFS(nodes_[node].left, code + "0", out);
+    if (nodes_[node].right) assignCodesDFS(nodes_[node].right, code + "1", out);
 }
 
 error_type HuffmanTree::writeHeader(std::ostream& os) const {
@@ -112,11 +327,11 @@ error_type HuffmanTree::writeHeader(std::ostream& os) const {
         return UNABLE_TO_OPEN_FILE_FOR_WRITING;
     }
     
-    if (root_ == nullptr) return NO_ERROR;
+    if (root_ == kNil) return NO_ERROR;
     
     // Special case: single word
-    if (root_->isLeaf()) {
-        os << root_->word << " 0\n";
+    if (isLeaf(root_)) {
+        os << wordOf(root_) << " 0\n";
         if (!os) return FAILED_TO_WRITE_FILE;
         return NO_ERROR;
     }
@@ -128,27 +343,40 @@ error_type HuffmanTree::writeHeader(std::ostream& os) const {
     return NO_ERROR;
 }
 
-void HuffmanTree::writeHeaderPreorder(TreeNode* node, const std::string& code, std::ostream& os) const {
-    if (node == nullptr) return;
+void HuffmanTree::writeHeaderPreorder(Index node, const std::string& code, std::ostream& os) const {
+    if (node == kNil) return;
     
-    if (node->isLeaf()) {
-        os << node->word << " " << code << '\n';
+    if (isLeaf(node)) {
+        os << wordOf(node) << " " << code << '\n';
         return;
     }
     
     // Visit left before right (pre-order)
-    if (node->left) writeHeaderPreorder(node->left, code + "0", os);
-    if (node->right) writeHeaderPreorder(node->right, code + "1", os);
+    if (nodes_[node].left) writeHeaderPreorder(nodes_[node].left, code + "0", os);
+    if (nodes_[node].right) writeHeaderPreorder(nodes_[node].right, code + "1", os);
 }
 
 error_type HuffmanTree::encode(const std::vector<std::string>& tokens,
                                 std::ostream& os_bits,
                                 int wrap_cols) const {
+    return encodeTokens(tokens, os_bits, wrap_cols);
+}
+
+error_type HuffmanTree::encode(const std::vector<std::string_view>& tokens,
+                                std::ostream& os_bits,
+                                int wrap_cols) const {
+    return encodeTokens(tokens, os_bits, wrap_cols);
+}
+
+template <typename Token>
+error_type HuffmanTree::encodeTokens(const std::vector<Token>& tokens,
+                                     std::ostream& os_bits,
+                                     int wrap_cols) const {
     if (!os_bits.good()) {
         return UNABLE_TO_OPEN_FILE_FOR_WRITING;
     }
     
-    if (root_ == nullptr || tokens.empty()) {
+    if (root_ == kNil || tokens.empty()) {
         os_bits << '\n';
         return NO_ERROR;
     }
@@ -157,13 +385,14 @@ error_type HuffmanTree::encode(const std::vector<std::string>& tokens,
     std::vector<std::pair<std::string, std::string>> codeList;
     assignCodes(codeList);
     
-    std::map<std::string, std::string> codebook;
+    std::map<std::string, std::string, std::less<>> codebook;
     for (const auto& pair : codeList) {
         codebook[pair.first] = pair.second;
     }
     
-    // Encode tokens
-    int col = 0;
+    // Encode tokens, filling one output line at a time
+    std::string line;
+    line.reserve(wrap_cols + 1);
     for (const auto& token : tokens) {
         auto it = codebook.find(token);
         if (it == codebook.end()) {
@@ -173,25 +402,44 @@ error_type HuffmanTree::encode(const std::vector<std::string>& tokens,
         
         const std::string& code = it->second;
         for (char bit : code) {
-            os_bits << bit;
-            col++;
+            line += bit;
             
-            if (col >= wrap_cols) {
-                os_bits << '\n';
-                col = 0;
+            if (static_cast<int>(line.size()) >= wrap_cols) {
+                line += '\n';
+                os_bits.write(line.data(), line.size());
+                line.clear();
             }
         }
     }
     
     // Write final newline if we haven't just written one
-    if (col > 0) {
-        os_bits << '\n';
+    if (!line.empty()) {
+        line += '\n';
+        os_bits.write(line.data(), line.size());
     }
     
     if (!os_bits) return FAILED_TO_WRITE_FILE;
     return NO_ERROR;
 }
 
+error_type HuffmanTree::encodeBinary(const std::vector<std::string_view>& tokens,
+                                     std::ostream& os_bits) const {
+    if (!os_bits.good()) {
+        return UNABLE_TO_OPEN_FILE_FOR_WRITING;
+    }
+    
+    std::vector<std::pair<std::string, std::string>> codebook;
+    assignCodes(codebook);
+    
+    TokenEncoder encoder(codebook, os_bits, TokenEncoder::Format::Binary);
+    for (std::string_view token : tokens) {
+        if (error_type status = encoder.put(token); status != NO_ERROR) {
+            return status;
+        }
+    }
+    return encoder.finish();
+}
+
 bool HuffmanTree::isEmpty() const {
-    return root_ == nullptr;
+    return root_ == kNil;
 }
@@ -2,10 +2,13 @@
 #define HUFFMANTREE_HPP
 
 #include <string>
+#include <string_view>
 #include <vector>
 #include <utility>
 #include <ostream>
+#include <cstdint>
 #include "utils.hpp"
+#include "StringArena.hpp"
 
 // ============================================================================
 // NEW FILE FOR PHASE 3: HuffmanTree class
@@ -18,6 +21,8 @@ public:
     
     // Build Huffman tree from frequency list
     // Input: vector of (word, count) pairs sorted by count descending
+    // (O(n) two-queue build). Any other order is accepted and gives the same
+    // tree as before, in O(n log^2 n).
     void buildFromFrequencies(const std::vector<std::pair<std::string, size_t>>& freqs);
     
     // Get the height of the Huffman tree
@@ -27,6 +32,9 @@ public:
     // Output: vector of (word, bitstring_code) pairs
     void assignCodes(std::vector<std::pair<std::string, std::string>>& out) const;
     
+    // Code length (depth) of every leaf, in pre-order. A lone word gets length 1.
+    void getCodeLengths(std::vector<std::pair<std::string, int>>& out) const;
+    
     // Write header file: "word code\n" for each leaf in pre-order
     error_type writeHeader(std::ostream& os) const;
     
@@ -35,37 +43,54 @@ public:
     error_type encode(const std::vector<std::string>& tokens,
                       std::ostream& os_bits,
                       int wrap_cols = 80) const;
+    error_type encode(const std::vector<std::string_view>& tokens,
+                      std::ostream& os_bits,
+                      int wrap_cols = 80) const;
+    
+    // Encode tokens as a packed bitstream with a bit-count trailer (see BitWriter)
+    error_type encodeBinary(const std::vector<std::string_view>& tokens,
+                            std::ostream& os_bits) const;
     
     // Check if tree is empty
     bool isEmpty() const;
 
+    // Bytes of node storage per node (excluding the word bytes in the arena)
+    static constexpr size_t bytesPerNode() { return sizeof(TreeNode); }
+
 private:
+    // Nodes live in one contiguous pool and refer to each other by 32-bit
+    // index; leaf words are (offset, length) into a StringArena. Index 0 is
+    // a sentinel that plays the role of nullptr.
+    // 32 bytes per node, versus 56 for the old pointer/std::string node plus
+    // its malloc header.
+    using Index = uint32_t;
+    static constexpr Index kNil = 0;
+
     struct TreeNode {
-        std::string word;      // empty for internal nodes
         size_t frequency;      // combined frequency for internal nodes
-        TreeNode* left;
-        TreeNode* right;
-        
-        // Constructor for leaf node
-        TreeNode(const std::string& w, size_t freq)
-            : word(w), frequency(freq), left(nullptr), right(nullptr) {}
-        
-        // Constructor for internal node
-        TreeNode(TreeNode* l, TreeNode* r)
-            : word(""), frequency(l->frequency + r->frequency),
-              left(l), right(r) {}
-        
-        bool isLeaf() const { return left == nullptr && right == nullptr; }
+        size_t wordOffset;     // leaves only
+        uint32_t wordLength;   // 0 for internal nodes
+        Index left;
+        Index right;
     };
     
-    TreeNode* root_;
+    std::vector<TreeNode> nodes_;   // nodes_[0] is the kNil sentinel
+    StringArena words_;
+    Index root_;
     
     // Helper functions
-    void destroy(TreeNode* node);
-    int height(TreeNode* node) const;
-    void assignCodesDFS(TreeNode* node, const std::string& code,
+    Index newLeaf(const std::string& word, size_t frequency);
+    Index newInternal(Index left, Index right);
+    Index buildTwoQueue(const std::vector<Index>& leaves);
+    Index buildReplay(const std::vector<Index>& leaves);
+    bool isLeaf(Index node) const { return nodes_[node].left == kNil && nodes_[node].right == kNil; }
+    std::string_view wordOf(Index node) const;
+    int height(Index node) const;
+    void assignCodesDFS(Index node, const std::string& code,
                        std::vector<std::pair<std::string, std::string>>& out) const;
-    void writeHeaderPreorder(TreeNode* node, const std::string& code, std::ostream& os) const;
+    void writeHeaderPreorder(Index node, const std::string& code, std::ostream& os) const;
+    template <typename Token>
+    error_type encodeTokens(const std::vector<Token>& tokens, std::ostream& os_bits, int wrap_cols) const;
 };
 
 #endif // HUFFMANTREE_HPP
@@ -0,0 +1,37 @@
+#ifndef MAPPEDFILE_HPP
+#define MAPPEDFILE_HPP
+
+#include <cstddef>
+#include <filesystem>
+#include "utils.hpp"
+
+// Read-only memory mapping of a whole input file.
+// The mapping is released when the object is destroyed or close() is called.
+class MappedFile {
+public:
+    MappedFile();
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& other) noexcept;
+    MappedFile& operator=(MappedFile&& other) noexcept;
+
+    // Map 'path' for reading. An empty file maps to (nullptr, 0).
+    error_type open(const std::filesystem::path& path);
+
+    // Drop the pages before 'end' from memory (re-read from disk if touched again)
+    void release(size_t end);
+
+    // Unmap the file (no-op if nothing is mapped)
+    void close();
+
+    const char* data() const { return data_; }
+    size_t size() const { return size_; }
+
+private:
+    const char* data_;
+    size_t size_;
+};
+
+#endif // MAPPEDFILE_HPP
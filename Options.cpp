@@ -0,0 +1,197 @@
+#include "Options.hpp"
+#include "CanonicalCode.hpp"
+#include <algorithm>
+#include <iostream>
+#include <thread>
+
+// Parse the unsigned value of "--name=value"; false if it isn't a number
+// or does not fit in 'out'
+template <typename Unsigned>
+static bool parseUnsigned(const std::string& value, Unsigned& out) {
+    if (value.empty() || value.find_first_not_of("0123456789") != std::string::npos) {
+        return false;
+    }
+    try {
+        unsigned long long parsed = std::stoull(value);
+        out = static_cast<Unsigned>(parsed);
+        return parsed == out;
+    } catch (const std::exception&) {
+        return false;
+    }
+}
+
+// Parse a non-negative decimal such as "1" or "0.5"
+static bool parseDecimal(const std::string& value, double& out) {
+    if (value.empty() || value.find_first_not_of("0123456789.") != std::string::npos ||
+        value.find('.') != value.rfind('.') || value == ".") {
+        return false;
+    }
+    try {
+        out = std::stod(value);
+        return true;
+    } catch (const std::exception&) {
+        return false;
+    }
+}
+
+error_type parseArguments(int argc, char* argv[], Options& options) {
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+
+        if (arg.rfind("--", 0) != 0) {
+            // Positional argument: the input file (several with --batch)
+            if (options.inputFileNames.empty()) {
+                options.inputFileName = arg;
+            }
+            options.inputFileNames.push_back(arg);
+            continue;
+        }
+
+        const size_t eq = arg.find('=');
+        const std::string name = arg.substr(0, eq);
+        const std::string value = eq == std::string::npos ? "" : arg.substr(eq + 1);
+
+        if (name == "--threads") {
+            if (!parseUnsigned(value, options.threads)) {
+                return INVALID_ARGUMENTS;
+            }
+            if (options.threads == 0) {
+                options.threads = std::max(1u, std::thread::hardware_concurrency());
+            }
+        } else if (name == "--counter") {
+            if (value == "bst") {
+                options.counter = CounterBackend::Tree;
+            } else if (value == "avl") {
+                options.counter = CounterBackend::Avl;
+            } else if (value == "hash") {
+                options.counter = CounterBackend::Hash;
+            } else {
+                return INVALID_ARGUMENTS;
+            }
+        } else if (arg == "--canonical") {
+            options.canonical = true;
+        } else if (arg == "--binary") {
+            options.binary = true;
+        } else if (name == "--max-code-len") {
+            if (!parseUnsigned(value, options.maxCodeLength) || options.maxCodeLength == 0 ||
+                options.maxCodeLength > CanonicalCode::kMaxCodeLength) {
+                return INVALID_ARGUMENTS;
+            }
+            options.canonical = true;
+        } else if (name == "--block-tokens") {
+            if (!parseUnsigned(value, options.blockTokens) || options.blockTokens == 0) {
+                return INVALID_ARGUMENTS;
+            }
+        } else if (name == "--block-bytes") {
+            if (!parseUnsigned(value, options.blockBytes) || options.blockBytes == 0) {
+                return INVALID_ARGUMENTS;
+            }
+        } else if (name == "--range") {
+            const size_t colon = value.find(':');
+            if (colon == std::string::npos ||
+                !parseUnsigned(value.substr(0, colon), options.rangeFirst) ||
+                !parseUnsigned(value.substr(colon + 1), options.rangeCount)) {
+                return INVALID_ARGUMENTS;
+            }
+            options.range = true;
+        } else if (arg == "--streaming") {
+            options.streaming = true;
+        } else if (arg == "--decode") {
+            options.decode = true;
+        } else if (name == "--stats") {
+            if (value != "json") {
+                return INVALID_ARGUMENTS;
+            }
+            options.statsJson = true;
+        } else if (arg == "--batch") {
+            options.batch = true;
+        } else if (name == "--train" && !value.empty()) {
+            options.trainFileName = value;
+        } else if (name == "--dict" && !value.empty()) {
+            options.dictionaryFileName = value;
+        } else if (arg == "--adaptive") {
+            options.adaptive = true;
+        } else if (name == "--approx") {
+            if (!parseUnsigned(value, options.approxWords) || options.approxWords == 0 ||
+                options.approxWords > UINT32_MAX / 2) {
+                return INVALID_ARGUMENTS;
+            }
+        } else if (name == "--sketch") {
+            if (eq == std::string::npos) {
+                options.sketchWidth = SIZE_MAX;   // 4K, once K is known
+            } else if (!parseUnsigned(value, options.sketchWidth) || options.sketchWidth == 0) {
+                return INVALID_ARGUMENTS;
+            }
+        } else if (arg == "--compare-exact") {
+            options.compareExact = true;
+        } else if (arg == "--hybrid") {
+            options.hybrid = true;
+        } else if (name == "--append") {
+            if (eq != std::string::npos && !parseDecimal(value, options.appendThreshold)) {
+                return INVALID_ARGUMENTS;
+            }
+            options.append = true;
+        } else {
+            return INVALID_ARGUMENTS;
+        }
+    }
+
+    if (options.range && !options.decode) {
+        return INVALID_ARGUMENTS;
+    }
+    if (options.batch ? options.decode : options.inputFileNames.size() > 1) {
+        return INVALID_ARGUMENTS;
+    }
+    // Training only counts; a dictionary fixes the code and the format
+    if (!options.trainFileName.empty() &&
+        (options.batch || options.decode || !options.dictionaryFileName.empty())) {
+        return INVALID_ARGUMENTS;
+    }
+    if (!options.dictionaryFileName.empty() &&
+        (options.blockTokens > 0 || options.blockBytes > 0 || options.maxCodeLength > 0)) {
+        return INVALID_ARGUMENTS;
+    }
+    // Appending continues one file's existing ASCII or binary stream
+    if (options.append && (options.batch || options.decode || options.blockTokens > 0 || options.blockBytes > 0 ||
+                           !options.trainFileName.empty() || !options.dictionaryFileName.empty())) {
+        return INVALID_ARGUMENTS;
+    }
+    // The adaptive code is the whole format: no header, container or dictionary
+    if (options.adaptive && (options.batch || options.append || options.canonical ||
+                             options.blockTokens > 0 || options.blockBytes > 0 ||
+                             !options.trainFileName.empty() || !options.dictionaryFileName.empty())) {
+        return INVALID_ARGUMENTS;
+    }
+    // Approximate counting writes its own escape-coded format (see
+    // encodeApproximate); a sketch and the comparison only go with it
+    if (options.approxWords > 0 && (options.batch || options.decode || options.append || options.adaptive ||
+                                    options.streaming || options.canonical ||
+                                    options.blockTokens > 0 || options.blockBytes > 0 ||
+                                    !options.trainFileName.empty() || !options.dictionaryFileName.empty())) {
+        return INVALID_ARGUMENTS;
+    }
+    if (options.approxWords == 0 && (options.sketchWidth > 0 || options.compareExact)) {
+        return INVALID_ARGUMENTS;
+    }
+    // So does --hybrid, from exact counts
+    if (options.hybrid && (options.batch || options.decode || options.append || options.adaptive ||
+                           options.streaming || options.canonical ||
+                           options.blockTokens > 0 || options.blockBytes > 0 ||
+                           !options.trainFileName.empty() || !options.dictionaryFileName.empty() ||
+                           options.approxWords > 0)) {
+        return INVALID_ARGUMENTS;
+    }
+    if (options.sketchWidth == SIZE_MAX) {
+        options.sketchWidth = 4 * options.approxWords;
+    }
+    return options.inputFileName.empty() ? INVALID_ARGUMENTS : NO_ERROR;
+}
+
+void printUsage(const char* programName) {
+    std::cerr << "Usage: " << programName << " [--threads=N] [--counter=bst|avl|hash] [--canonical] [--max-code-len=L] [--binary] [--block-tokens=N] [--block-bytes=N] [--streaming]"
+              << " [--decode [--range=FIRST:COUNT]] [--dict=DICT] [--append[=PCT]] [--adaptive] [--stats=json] <filename>\n"
+              << "       " << programName << " --approx=K [--sketch[=WIDTH]] [--compare-exact] [--binary] [--stats=json] <filename>\n"
+              << "       " << programName << " --hybrid [--binary] [--stats=json] <filename>\n"
+              << "       " << programName << " --batch [options] <file or directory>...\n"
+              << "       " << programName << " --train=DICT <corpus>\n";
+}
@@ -0,0 +1,118 @@
+#ifndef OPTIONS_HPP
+#define OPTIONS_HPP
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "utils.hpp"
+#include "BST.hpp"
+
+// Command-line options for the encoder:
+//   huffman_encoder [--threads=N] [--counter=bst|avl|hash] [--canonical] [--max-code-len=L] [--binary] [--block-tokens=N] [--block-bytes=N] [--streaming]
+//                   [--decode [--range=FIRST:COUNT]] [--dict=DICT] [--append[=PCT]] [--adaptive] [--stats=json] <filename>
+//   huffman_encoder --approx=K [--sketch[=WIDTH]] [--compare-exact] [--binary] [--stats=json] <filename>
+//   huffman_encoder --hybrid [--binary] [--stats=json] <filename>
+//   huffman_encoder --batch [options] <file or directory>...
+//   huffman_encoder --train=DICT <corpus>
+struct Options {
+    // The first positional argument, and all of them (more than one only
+    // with --batch)
+    std::string inputFileName;
+    std::vector<std::string> inputFileNames;
+
+    // Worker threads for tokenizing and counting, and for decoding the blocks
+    // of a container (1 = serial path, 0 on the command line = one per
+    // hardware thread)
+    unsigned threads = 1;
+
+    // Let a single-threaded scan run as the reader / tokenizer / counter
+    // pipeline (two more threads). Not a command-line option: off for the
+    // files of --batch, whose pool already runs one file per thread.
+    bool scanPipeline = true;
+
+    // Frequency-counting backend behind the BST interface
+    CounterBackend counter = CounterBackend::Tree;
+
+    // Canonical codes with a front-coded, lengths-only .hdr
+    bool canonical = false;
+
+    // Limit every code to this many bits (package-merge; implies --canonical).
+    // 0 = no limit.
+    unsigned maxCodeLength = 0;
+
+    // Packed binary .code instead of ASCII '0'/'1'
+    bool binary = false;
+
+    // Tokens per block of the seekable block container (0 = no container)
+    unsigned blockTokens = 0;
+
+    // Payload bytes per block of the container: a block ends with the token
+    // that takes it to N bytes (0 = no bound; with --block-tokens, whichever
+    // comes first)
+    unsigned blockBytes = 0;
+
+    // Two passes over the file (count, then encode) without holding the
+    // tokens in memory; serial, so --threads is ignored
+    bool streaming = false;
+
+    // Decode <base>.hdr + <base>.code into <base>.decoded instead of encoding
+    bool decode = false;
+
+    // With --decode, only tokens [rangeFirst, rangeFirst + rangeCount)
+    bool range = false;
+    uint64_t rangeFirst = 0;
+    uint64_t rangeCount = 0;
+
+    // --stats=json: per-phase timings, allocations, I/O bytes and peak RSS
+    // as one JSON object on stderr
+    bool statsJson = false;
+
+    // Encode every input file (and the .txt files of every input directory)
+    // in one process, --threads files at a time on a work-stealing pool
+    bool batch = false;
+
+    // --train=DICT: count the input and write a shared dictionary to DICT
+    // instead of encoding
+    std::string trainFileName;
+
+    // --dict=DICT: encode (or decode) against the shared dictionary in DICT,
+    // in one pass, with no .tokens, .freq or .hdr
+    std::string dictionaryFileName;
+
+    // --append[=PCT]: the input only grew since the last --append run; scan
+    // just the new bytes and merge their counts. The .hdr is rebuilt only
+    // when the current code costs more than PCT percent over an optimal one.
+    bool append = false;
+    double appendThreshold = 1.0;
+
+    // One pass with adaptive Huffman codes: bits are written as the input
+    // is read (which may be a pipe), with no .tokens, .freq or .hdr
+    bool adaptive = false;
+
+    // --approx=K: count in bounded memory with a SpaceSaving table of K
+    // words; only the words it keeps get codes, every other word is escaped
+    // and spelled out (0 = exact counting)
+    size_t approxWords = 0;
+
+    // --sketch[=WIDTH]: with --approx, a Count-Min sketch of WIDTH counters
+    // per row (default 4K) decides which words enter the table
+    size_t sketchWidth = 0;
+
+    // --compare-exact: with --approx, also count exactly and report the
+    // compression lost against the exact code
+    bool compareExact = false;
+
+    // --hybrid: code only the words seen at least a threshold number of
+    // times and spell out the rest, with the threshold that makes .hdr plus
+    // .code smallest
+    bool hybrid = false;
+};
+
+// Parse argv into 'options'. Returns INVALID_ARGUMENTS on unknown flags,
+// malformed values or a missing filename.
+error_type parseArguments(int argc, char* argv[], Options& options);
+
+// Print the usage line to stderr
+void printUsage(const char* programName);
+
+#endif // OPTIONS_HPP
@@ -0,0 +1,221 @@
+#include "OutputFile.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <climits>
+#include <condition_variable>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+struct OutputFile::State {
+    int fd;
+    size_t pending;   // buffers queued or being written
+    bool failed;
+};
+
+namespace {
+
+struct Job {
+    std::shared_ptr<OutputFile::State> file;
+    std::unique_ptr<char[]> data;
+    size_t size;
+};
+
+// Write 'jobs' (all for one file) with as few writev calls as it takes
+bool writeJobs(int fd, std::vector<Job>::iterator first, std::vector<Job>::iterator last) {
+    std::vector<iovec> parts;
+    for (auto job = first; job != last; ++job) {
+        parts.push_back(iovec{job->data.get(), job->size});
+    }
+    size_t done = 0;
+    while (done < parts.size()) {
+        const int count = static_cast<int>(std::min<size_t>(parts.size() - done, IOV_MAX));
+        ssize_t written = ::writev(fd, parts.data() + done, count);
+        if (written < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        // Skip what was written; a part may have gone out only in part
+        while (done < parts.size() && static_cast<size_t>(written) >= parts[done].iov_len) {
+            written -= static_cast<ssize_t>(parts[done].iov_len);
+            ++done;
+        }
+        if (done < parts.size()) {
+            parts[done].iov_base = static_cast<char*>(parts[done].iov_base) + written;
+            parts[done].iov_len -= static_cast<size_t>(written);
+        }
+    }
+    return true;
+}
+
+// The I/O thread, started on first use and joined at exit once every
+// queued buffer is written
+class IoThread {
+public:
+    static IoThread& instance() {
+        static IoThread thread;
+        return thread;
+    }
+
+    // A buffer of OutputFile::kBufferSize bytes, recycled if one is free
+    std::unique_ptr<char[]> takeBuffer() {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (free_.empty()) {
+            return std::unique_ptr<char[]>(new char[OutputFile::kBufferSize]);
+        }
+        std::unique_ptr<char[]> buffer = std::move(free_.back());
+        free_.pop_back();
+        return buffer;
+    }
+
+    // Queue 'size' bytes of 'data' for 'file', waiting while kMaxQueued
+    // buffers are in flight. Returns false if a write to 'file' has failed.
+    bool submit(const std::shared_ptr<OutputFile::State>& file, std::unique_ptr<char[]> data, size_t size) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        done_.wait(lock, [&] { return inFlight_ < OutputFile::kMaxQueued; });
+        ++inFlight_;
+        ++file->pending;
+        jobs_.push_back(Job{file, std::move(data), size});
+        work_.notify_one();
+        return !file->failed;
+    }
+
+    // Wait until nothing is queued for 'file'. Returns false if a write failed.
+    bool wait(OutputFile::State& file) {
+        std::unique_lock<std::mutex> lock(mutex_);
+        done_.wait(lock, [&] { return file.pending == 0; });
+        return !file.failed;
+    }
+
+private:
+    IoThread() : inFlight_(0), stopping_(false), thread_([this] { run(); }) {}
+
+    ~IoThread() {
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            stopping_ = true;
+        }
+        work_.notify_one();
+        thread_.join();
+    }
+
+    void run() {
+        std::vector<Job> batch;
+        std::unique_lock<std::mutex> lock(mutex_);
+        while (true) {
+            work_.wait(lock, [&] { return stopping_ || !jobs_.empty(); });
+            if (jobs_.empty()) return;
+            batch.assign(std::make_move_iterator(jobs_.begin()), std::make_move_iterator(jobs_.end()));
+            jobs_.clear();
+            lock.unlock();
+
+            // Runs of buffers for the same file go out together. 'failed' is
+            // only set by this thread, so it can be read here unlocked.
+            std::vector<bool> failed(batch.size(), false);
+            for (size_t i = 0; i < batch.size();) {
+                size_t j = i + 1;
+                while (j < batch.size() && batch[j].file == batch[i].file) ++j;
+                if (!batch[i].file->failed && !writeJobs(batch[i].file->fd, batch.begin() + i, batch.begin() + j)) {
+                    std::fill(failed.begin() + i, failed.begin() + j, true);
+                }
+                i = j;
+            }
+
+            lock.lock();
+            for (size_t i = 0; i < batch.size(); ++i) {
+                Job& job = batch[i];
+                job.file->failed = job.file->failed || failed[i];
+                --job.file->pending;
+                if (free_.size() < OutputFile::kMaxQueued) {
+                    free_.push_back(std::move(job.data));
+                }
+            }
+            inFlight_ -= batch.size();
+            batch.clear();
+            done_.notify_all();
+        }
+    }
+
+    std::mutex mutex_;
+    std::condition_variable work_;   // jobs queued, or stopping
+    std::condition_variable done_;   // buffers written
+    std::deque<Job> jobs_;
+    std::vector<std::unique_ptr<char[]>> free_;
+    size_t inFlight_;
+    bool stopping_;
+    std::thread thread_;
+};
+
+} // namespace
+
+OutputFile::OutputFile() : stream_(this) {}
+
+OutputFile::~OutputFile() {
+    close();
+}
+
+error_type OutputFile::open(const std::string& filename, bool append) {
+    close();
+    const int fd = ::open(filename.c_str(), O_WRONLY | O_CREAT | (append ? O_APPEND : O_TRUNC), 0666);
+    if (fd < 0) {
+        return UNABLE_TO_OPEN_FILE_FOR_WRITING;
+    }
+    state_ = std::make_shared<State>(State{fd, 0, false});
+    buffer_ = IoThread::instance().takeBuffer();
+    setp(buffer_.get(), buffer_.get() + kBufferSize);
+    stream_.clear();
+    return NO_ERROR;
+}
+
+error_type OutputFile::close() {
+    if (!state_) return NO_ERROR;
+    bool ok = handOff() && IoThread::instance().wait(*state_);
+    ok = ::close(state_->fd) == 0 && ok;
+    state_.reset();
+    buffer_.reset();
+    setp(nullptr, nullptr);
+    return ok ? NO_ERROR : FAILED_TO_WRITE_FILE;
+}
+
+bool OutputFile::handOff() {
+    if (!state_) return false;
+    const size_t size = static_cast<size_t>(pptr() - pbase());
+    if (size == 0) return true;
+    IoThread& thread = IoThread::instance();
+    const bool ok = thread.submit(state_, std::move(buffer_), size);
+    buffer_ = thread.takeBuffer();
+    setp(buffer_.get(), buffer_.get() + kBufferSize);
+    return ok;
+}
+
+OutputFile::int_type OutputFile::overflow(int_type c) {
+    if (!handOff()) return traits_type::eof();
+    if (!traits_type::eq_int_type(c, traits_type::eof())) {
+        *pptr() = traits_type::to_char_type(c);
+        pbump(1);
+    }
+    return traits_type::not_eof(c);
+}
+
+std::streamsize OutputFile::xsputn(const char* data, std::streamsize size) {
+    std::streamsize copied = 0;
+    while (copied < size) {
+        if (pptr() == epptr() && !handOff()) break;
+        const std::streamsize room = std::min<std::streamsize>(epptr() - pptr(), size - copied);
+        std::memcpy(pptr(), data + copied, static_cast<size_t>(room));
+        pbump(static_cast<int>(room));
+        copied += room;
+    }
+    return copied;
+}
+
+int OutputFile::sync() {
+    return handOff() ? 0 : -1;
+}
@@ -0,0 +1,58 @@
+#ifndef OUTPUTFILE_HPP
+#define OUTPUTFILE_HPP
+
+#include <cstddef>
+#include <memory>
+#include <ostream>
+#include <streambuf>
+#include <string>
+
+#include "utils.hpp"
+
+// An output file written by a background I/O thread. Text goes through
+// stream() into a large buffer; a full buffer is handed to the thread,
+// which writes it while the caller carries on, and the caller continues in
+// a recycled buffer. The thread writes all the buffers queued for a file
+// with one writev. At most kMaxQueued buffers are in flight, so memory
+// stays bounded when the disk is slower than the caller.
+//
+// One thread serves every OutputFile of the process, so the .tokens,
+// .freq, .hdr and .code writes (and the files of --batch) overlap with each
+// other and with the computation that follows them. A failed write sets
+// the stream's badbit at the next hand-off and is returned by close().
+class OutputFile : private std::streambuf {
+public:
+    static constexpr size_t kBufferSize = size_t(1) << 20;
+    static constexpr size_t kMaxQueued = 16;
+
+    struct State;   // shared with the I/O thread
+
+    OutputFile();
+    ~OutputFile();   // close(), ignoring errors
+
+    OutputFile(const OutputFile&) = delete;
+    OutputFile& operator=(const OutputFile&) = delete;
+
+    // Create or truncate 'filename', or with 'append' add to its end
+    error_type open(const std::string& filename, bool append = false);
+    bool is_open() const { return state_ != nullptr; }
+
+    std::ostream& stream() { return stream_; }
+
+    // Hand over what is buffered, wait until everything is written and
+    // close the file. FAILED_TO_WRITE_FILE if any write failed.
+    error_type close();
+
+private:
+    int_type overflow(int_type c) override;
+    std::streamsize xsputn(const char* data, std::streamsize size) override;
+    int sync() override;   // hand over what is buffered, without waiting
+
+    bool handOff();
+
+    std::shared_ptr<State> state_;
+    std::unique_ptr<char[]> buffer_;
+    std::ostream stream_;
+};
+
+#endif // OUTPUTFILE_HPP
@@ -0,0 +1,78 @@
+#include "PackageMerge.hpp"
+#include <algorithm>
+#include <cstdint>
+
+error_type packageMergeLengths(const std::vector<std::pair<std::string, size_t>>& freqs,
+                               int maxLength,
+                               std::vector<std::pair<std::string, int>>& lengths) {
+    lengths.clear();
+    const size_t n = freqs.size();
+    if (n == 0) return NO_ERROR;
+    if (maxLength < 1 || (maxLength < 63 && (uint64_t(1) << maxLength) < n)) {
+        return LENGTH_LIMIT_TOO_SMALL;
+    }
+    if (n == 1) {
+        lengths.push_back({freqs[0].first, 1});
+        return NO_ERROR;
+    }
+
+    // Leaves by ascending count (ties by word, so the result is deterministic)
+    std::vector<size_t> order(n);
+    for (size_t i = 0; i < n; ++i) order[i] = i;
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return freqs[a].second != freqs[b].second ? freqs[a].second < freqs[b].second
+                                                  : freqs[a].first < freqs[b].first;
+    });
+    std::vector<uint64_t> leaf(n);
+    for (size_t i = 0; i < n; ++i) leaf[i] = freqs[order[i]].second;
+
+    // Build the lists from the deepest level up. The list of level j merges
+    // the leaves with the pairs ("packages") of level j + 1's list; for each
+    // level only "is this item a leaf" is kept.
+    const int levels = maxLength;
+    std::vector<std::vector<bool>> isLeaf(levels);
+    std::vector<uint64_t> current(leaf), next;
+    isLeaf[levels - 1].assign(n, true);
+    for (int level = levels - 2; level >= 0; --level) {
+        next.clear();
+        std::vector<bool>& marks = isLeaf[level];
+        size_t i = 0, p = 0;
+        const size_t packages = current.size() / 2;
+        while (i < n || p < packages) {
+            // Leaves win ties, which keeps codes as short as possible
+            if (p == packages || (i < n && leaf[i] <= current[2 * p] + current[2 * p + 1])) {
+                next.push_back(leaf[i++]);
+                marks.push_back(true);
+            } else {
+                next.push_back(current[2 * p] + current[2 * p + 1]);
+                ++p;
+                marks.push_back(false);
+            }
+        }
+        current.swap(next);
+    }
+
+    // The first 2n - 2 items of the top list form the optimal solution.
+    // Walking down, the leaves among the first k items of a level are the k'
+    // lightest leaves; each gains one bit, and the packages among them
+    // select the first 2 * packages items of the next level.
+    std::vector<int> depth(n, 0);
+    size_t take = 2 * n - 2;
+    for (int level = 0; level < levels && take > 0; ++level) {
+        const std::vector<bool>& marks = isLeaf[level];
+        size_t leaves = 0;
+        for (size_t i = 0; i < take; ++i) {
+            leaves += marks[i];
+        }
+        for (size_t i = 0; i < leaves; ++i) {
+            ++depth[i];
+        }
+        take = 2 * (take - leaves);
+    }
+
+    lengths.reserve(n);
+    for (size_t i = 0; i < n; ++i) {
+        lengths.push_back({freqs[order[i]].first, depth[i]});
+    }
+    return NO_ERROR;
+}
@@ -0,0 +1,22 @@
+#ifndef PACKAGEMERGE_HPP
+#define PACKAGEMERGE_HPP
+
+#include <cstddef>
+#include <string>
+#include <utility>
+#include <vector>
+#include "utils.hpp"
+
+// Optimal code lengths with no code longer than 'maxLength' bits, by the
+// package-merge algorithm (Larmore and Hirschberg). Input is (word, count)
+// pairs in any order; output is (word, code length) pairs, ready for
+// CanonicalCode::build. A lone word gets length 1.
+//
+// Runs in O(n * maxLength) time and keeps one bit per list item per level
+// (about n * maxLength / 4 bytes) instead of the packages themselves.
+// Returns LENGTH_LIMIT_TOO_SMALL if 2^maxLength < number of words.
+error_type packageMergeLengths(const std::vector<std::pair<std::string, size_t>>& freqs,
+                               int maxLength,
+                               std::vector<std::pair<std::string, int>>& lengths);
+
+#endif // PACKAGEMERGE_HPP
@@ -0,0 +1,158 @@
+#include "ParallelScanner.hpp"
+#include <algorithm>
+#include <functional>
+#include <thread>
+#include <unordered_map>
+
+#include "ScanKernel.hpp"
+#include "Threads.hpp"
+
+namespace {
+
+struct WordStats {
+    size_t count;
+    size_t first;   // index of the first occurrence (chunk-local while counting)
+};
+
+struct MergedWord {
+    std::string_view word;
+    size_t count;
+    size_t first;   // global token index of the first occurrence
+};
+
+} // namespace
+
+struct ParallelScanner::Chunk {
+    size_t begin;
+    size_t end;
+    std::vector<std::string_view> words;
+    std::unordered_map<std::string_view, WordStats> counts;
+    // Lowercased copies; allocated once, sized to the rest of the chunk
+    std::unique_ptr<char[]> lower;
+    size_t lowerUsed = 0;
+
+    void scan(const char* data) {
+        const char* base = data + begin;
+        const size_t size = end - begin;
+
+        ScanKernel::forEachWord(base, size, [&](size_t b, size_t e, bool hasUpper) {
+            std::string_view word(base + b, e - b);
+            if (hasUpper) {
+                if (!lower) {
+                    lower = std::make_unique<char[]>(size - b);
+                }
+                char* out = lower.get() + lowerUsed;
+                ScanKernel::lowercase(out, word.data(), word.size());
+                lowerUsed += word.size();
+                word = std::string_view(out, word.size());
+            }
+
+            auto [it, inserted] = counts.try_emplace(word, WordStats{0, words.size()});
+            ++it->second.count;
+            words.push_back(word);
+        });
+    }
+};
+
+ParallelScanner::ParallelScanner(std::filesystem::path inputPath, unsigned threads)
+    : inputPath_(std::move(inputPath)), threads_(std::max(1u, threads)) {}
+
+ParallelScanner::~ParallelScanner() = default;
+
+std::vector<std::pair<size_t, size_t>> ParallelScanner::splitInput() const {
+    const char* data = input_.data();
+    const size_t size = input_.size();
+
+    std::vector<std::pair<size_t, size_t>> ranges;
+    size_t begin = 0;
+    for (unsigned i = 1; i <= threads_ && begin < size; ++i) {
+        size_t end = i == threads_ ? size : std::max(begin, size / threads_ * i);
+        // Tokens are runs of letters and apostrophes; cut on anything else
+        while (end < size && charClass(data[end]) != CC_SEPARATOR) {
+            ++end;
+        }
+        if (end > begin) {
+            ranges.emplace_back(begin, end);
+        }
+        begin = end;
+    }
+    return ranges;
+}
+
+error_type ParallelScanner::tokenize(std::vector<std::string_view>& words,
+                                     std::vector<std::pair<std::string, size_t>>& frequencies,
+                                     std::vector<std::pair<std::string_view, size_t>>& firstSeen) {
+    if (error_type status = input_.open(inputPath_); status != NO_ERROR) {
+        return status;
+    }
+
+    // 1) Tokenize and count each chunk on its own thread
+    chunks_.clear();
+    for (const auto& [begin, end] : splitInput()) {
+        auto chunk = std::make_unique<Chunk>();
+        chunk->begin = begin;
+        chunk->end = end;
+        chunks_.push_back(std::move(chunk));
+    }
+
+    const char* data = input_.data();
+    runOnThreads(chunks_.size(), [&](size_t i) { chunks_[i]->scan(data); });
+
+    // Global index of each chunk's first token
+    std::vector<size_t> chunkBase(chunks_.size() + 1, 0);
+    for (size_t i = 0; i < chunks_.size(); ++i) {
+        chunkBase[i + 1] = chunkBase[i] + chunks_[i]->words.size();
+    }
+
+    // 2) Merge the per-chunk tables, sharded by hash so every thread owns a
+    //    disjoint set of words. Chunks are visited in input order, so the first
+    //    insertion of a word records its earliest occurrence.
+    const size_t shards = threads_;
+    std::vector<std::vector<MergedWord>> merged(shards);
+    runOnThreads(shards, [&](size_t shard) {
+        std::hash<std::string_view> hasher;
+        std::unordered_map<std::string_view, MergedWord> table;
+        for (size_t c = 0; c < chunks_.size(); ++c) {
+            for (const auto& [word, stats] : chunks_[c]->counts) {
+                if (hasher(word) % shards != shard) continue;
+                auto [it, inserted] = table.try_emplace(word, MergedWord{word, 0, chunkBase[c] + stats.first});
+                it->second.count += stats.count;
+            }
+        }
+        merged[shard].reserve(table.size());
+        for (const auto& entry : table) {
+            merged[shard].push_back(entry.second);
+        }
+    });
+
+    std::vector<MergedWord> all;
+    for (auto& shard : merged) {
+        all.insert(all.end(), shard.begin(), shard.end());
+    }
+
+    // 3) Token stream in input order
+    words.reserve(words.size() + chunkBase.back());
+    for (const auto& chunk : chunks_) {
+        words.insert(words.end(), chunk->words.begin(), chunk->words.end());
+    }
+
+    // 4) Same lexicographic (word, count) list as BST::getFrequencies()
+    std::sort(all.begin(), all.end(),
+              [](const MergedWord& a, const MergedWord& b) { return a.word < b.word; });
+    frequencies.clear();
+    frequencies.reserve(all.size());
+    for (const auto& entry : all) {
+        frequencies.emplace_back(std::string(entry.word), entry.count);
+    }
+
+    // 5) First-occurrence order, to rebuild the serial BST shape
+    std::sort(all.begin(), all.end(),
+              [](const MergedWord& a, const MergedWord& b) { return a.first < b.first; });
+    firstSeen.clear();
+    firstSeen.reserve(all.size());
+    for (const auto& entry : all) {
+        firstSeen.emplace_back(entry.word, entry.count);
+    }
+
+    return NO_ERROR;
+}
@@ -0,0 +1,48 @@
+#ifndef PARALLELSCANNER_HPP
+#define PARALLELSCANNER_HPP
+
+#include <filesystem>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "utils.hpp"
+#include "MappedFile.hpp"
+
+// Multi-threaded front end: tokenizes and counts byte ranges of the input in
+// parallel and merges the per-thread counts.
+//
+// Chunk boundaries are moved forward to the next byte that is neither a letter
+// nor an apostrophe. No token (and no internal-apostrophe lookahead) can cross
+// such a byte, so each chunk tokenizes exactly as the serial Scanner would.
+class ParallelScanner {
+public:
+    ParallelScanner(std::filesystem::path inputPath, unsigned threads);
+    ~ParallelScanner();
+
+    // Tokenize and count the whole input.
+    //   words       - every token in input order (views into the mapping or
+    //                 into per-chunk lowercase arenas; valid for this object's lifetime)
+    //   frequencies - (word, count) pairs in lexicographic order, exactly what
+    //                 BST::getFrequencies() returns for the same tokens
+    //   firstSeen   - (word, count) pairs in order of first occurrence; inserting
+    //                 them into a BST reproduces the tree the serial path builds
+    error_type tokenize(std::vector<std::string_view>& words,
+                        std::vector<std::pair<std::string, size_t>>& frequencies,
+                        std::vector<std::pair<std::string_view, size_t>>& firstSeen);
+
+private:
+    struct Chunk;
+
+    // Split [0, size) into roughly equal ranges that start on separators
+    std::vector<std::pair<size_t, size_t>> splitInput() const;
+
+    std::filesystem::path inputPath_;
+    unsigned threads_;
+    MappedFile input_;
+    std::vector<std::unique_ptr<Chunk>> chunks_;
+};
+
+#endif // PARALLELSCANNER_HPP
@@ -0,0 +1,79 @@
+#include "PerfectHash.hpp"
+#include "HashCounter.hpp"
+
+#include <algorithm>
+#include <numeric>
+
+PerfectHash::PerfectHash() {}
+
+// Mix a seed into the word hash and reduce to a slot
+size_t PerfectHash::slotOf(uint64_t hash, uint32_t seed) const {
+    return static_cast<size_t>(HashCounter::mixHash(hash, seed) % values_.size());
+}
+
+error_type PerfectHash::build(const std::vector<std::string_view>& words) {
+    seeds_.assign(std::max<size_t>(1, (words.size() + kWordsPerBucket - 1) / kWordsPerBucket), 0);
+    values_.assign(words.size(), kNotFound);
+    offsets_.assign(words.size(), 0);
+    lengths_.assign(words.size(), 0);
+    words_.clear();
+    if (words.empty()) return NO_ERROR;
+
+    std::vector<uint64_t> hashes(words.size());
+    std::vector<std::vector<uint32_t>> buckets(seeds_.size());
+    for (size_t i = 0; i < words.size(); ++i) {
+        hashes[i] = HashCounter::hashWord(words[i]);
+        buckets[bucketOf(hashes[i])].push_back(static_cast<uint32_t>(i));
+    }
+
+    std::vector<uint32_t> order(buckets.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(),
+                     [&](uint32_t a, uint32_t b) { return buckets[a].size() > buckets[b].size(); });
+
+    std::vector<size_t> slots;
+    for (uint32_t bucket : order) {
+        const std::vector<uint32_t>& members = buckets[bucket];
+        if (members.empty()) break;
+
+        // First seed that puts every member in a free slot, distinct from the others
+        uint32_t seed = 0;
+        for (;; ++seed) {
+            if (seed == kMaxSeed) return INVALID_ARGUMENTS;   // equal hashes never separate
+            slots.clear();
+            bool fits = true;
+            for (uint32_t member : members) {
+                const size_t slot = slotOf(hashes[member], seed);
+                if (values_[slot] != kNotFound || std::find(slots.begin(), slots.end(), slot) != slots.end()) {
+                    fits = false;
+                    break;
+                }
+                slots.push_back(slot);
+            }
+            if (fits) break;
+        }
+
+        seeds_[bucket] = seed;
+        for (size_t k = 0; k < members.size(); ++k) {
+            values_[slots[k]] = members[k];
+        }
+    }
+
+    // Store the words in slot order for the compare in find()
+    for (size_t slot = 0; slot < values_.size(); ++slot) {
+        const std::string_view word = words[values_[slot]];
+        offsets_[slot] = words_.add(word);
+        lengths_[slot] = static_cast<uint32_t>(word.size());
+    }
+    return NO_ERROR;
+}
+
+uint32_t PerfectHash::find(std::string_view word) const {
+    if (values_.empty()) return kNotFound;
+    const uint64_t hash = HashCounter::hashWord(word);
+    const size_t slot = slotOf(hash, seeds_[bucketOf(hash)]);
+    if (lengths_[slot] != word.size() || words_.view(offsets_[slot], lengths_[slot]) != word) {
+        return kNotFound;
+    }
+    return values_[slot];
+}
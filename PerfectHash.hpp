@@ -0,0 +1,48 @@
+#ifndef PERFECTHASH_HPP
+#define PERFECTHASH_HPP
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include "utils.hpp"
+#include "StringArena.hpp"
+
+// Minimal perfect hash over a fixed set of words ("hash and displace"):
+// every word's 64-bit hash picks a bucket, and each bucket stores the seed
+// that sends all of its words to distinct, otherwise unused slots. A lookup
+// is one hash, one seed and one slot read, plus a compare with the stored
+// word so that words outside the set are rejected.
+//
+// Buckets are filled largest first; with about four words per bucket a
+// seed is found after a few tries even for the last, nearly full slots.
+class PerfectHash {
+public:
+    static constexpr uint32_t kNotFound = UINT32_MAX;
+
+    PerfectHash();
+
+    // Build over 'words' (distinct); word i maps to value i.
+    // INVALID_ARGUMENTS if two words share a 64-bit hash.
+    error_type build(const std::vector<std::string_view>& words);
+
+    // Index of 'word' in the build list, or kNotFound
+    uint32_t find(std::string_view word) const;
+
+    size_t size() const { return values_.size(); }
+
+private:
+    static constexpr size_t kWordsPerBucket = 4;
+    static constexpr uint32_t kMaxSeed = 1u << 24;
+
+    size_t slotOf(uint64_t hash, uint32_t seed) const;
+    size_t bucketOf(uint64_t hash) const { return (hash >> 32) % seeds_.size(); }
+
+    std::vector<uint32_t> seeds_;    // per bucket
+    std::vector<uint32_t> values_;   // per slot: index in the build list
+    std::vector<uint64_t> offsets_;  // per slot, into words_
+    std::vector<uint32_t> lengths_;  // per slot
+    StringArena words_;
+};
+
+#endif // PERFECTHASH_HPP
@@ -0,0 +1,1538 @@
+#include "Pipeline.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <map>
+#include <set>
+#include <sstream>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "Scanner.hpp"
+#include "ParallelScanner.hpp"
+#include "BST.hpp"
+#include "PriorityQueue.hpp"
+#include "HuffmanTree.hpp"
+#include "CanonicalCode.hpp"
+#include "TokenEncoder.hpp"
+#include "PackageMerge.hpp"
+#include "TokenInterner.hpp"
+#include "Threads.hpp"
+#include "Stats.hpp"
+#include "BitWriter.hpp"
+#include "BlockIndex.hpp"
+#include "HuffmanDecoder.hpp"
+#include "MappedFile.hpp"
+#include "AdaptiveCoder.hpp"
+#include "OutputFile.hpp"
+#include "SpaceSaving.hpp"
+#include "CountMinSketch.hpp"
+
+// 6) of encodeFile: build the Huffman tree from (word, count) pairs in word
+// order. With --canonical, the tree only supplies code lengths; codes are
+// reassigned canonically and the header stores lengths, front-coded. With
+// --max-code-len, package-merge supplies length-limited lengths instead.
+static error_type buildCode(const Options& options,
+                            const std::vector<std::pair<std::string, size_t>>& frequencies,
+                            const std::string& hdrFileName, HuffmanTree& huffman,
+                            CanonicalCode& canonical,
+                            std::vector<std::pair<std::string, int>>& limitedLengths,
+                            std::string& errorEntity) {
+    huffman.buildFromFrequencies(frequencies);
+    if (options.maxCodeLength > 0) {
+        if (error_type status = packageMergeLengths(frequencies, options.maxCodeLength, limitedLengths);
+            status != NO_ERROR) {
+            errorEntity = "--max-code-len=" + std::to_string(options.maxCodeLength);
+            return status;
+        }
+        if (error_type status = canonical.build(limitedLengths); status != NO_ERROR) {
+            errorEntity = hdrFileName;
+            return status;
+        }
+    } else if (options.canonical) {
+        std::vector<std::pair<std::string, int>> codeLengths;
+        huffman.getCodeLengths(codeLengths);
+        if (error_type status = canonical.build(std::move(codeLengths)); status != NO_ERROR) {
+            errorEntity = hdrFileName;
+            return status;
+        }
+    }
+    return NO_ERROR;
+}
+
+// 2) of encodeFile: whether one thread's scan runs as the reader /
+// tokenizer / counter pipeline. Its stages only overlap with a second core;
+// HUFFMAN_PIPELINE=on|off in the environment overrides the choice.
+static bool usePipeline() {
+    if (const char* forced = std::getenv("HUFFMAN_PIPELINE")) {
+        if (std::strcmp(forced, "on") == 0) return true;
+        if (std::strcmp(forced, "off") == 0) return false;
+    }
+    return std::thread::hardware_concurrency() > 1;
+}
+
+// 7) of encodeFile: write the code built by buildCode() to the .hdr
+static error_type writeCodeHeader(const Options& options, const HuffmanTree& huffman,
+                                  const CanonicalCode& canonical, std::ostream& hdrFile) {
+    return options.canonical ? canonical.writeHeader(hdrFile) : huffman.writeHeader(hdrFile);
+}
+
+// (word, '0'/'1' code) pairs of the code built by buildCode()
+static void getCodebook(const Options& options, const HuffmanTree& huffman, const CanonicalCode& canonical,
+                        std::vector<std::pair<std::string, std::string>>& codebook) {
+    if (options.canonical) {
+        canonical.getCodebook(codebook);
+    } else {
+        huffman.assignCodes(codebook);
+    }
+}
+
+// Set 'errorEntity' to the file (or option) 'status' concerns, and return it
+static error_type fail(error_type status, const std::string& entity, std::string& errorEntity) {
+    errorEntity = entity;
+    return status;
+}
+
+// Output files of one input: input_output/<base>.tokens, .freq, .hdr,
+// .code, and the .state of --append
+struct OutputNames {
+    std::string tokens;
+    std::string freq;
+    std::string hdr;
+    std::string code;
+    std::string state;
+};
+
+static OutputNames outputNames(const std::string& inputFileName) {
+    const std::string base = std::string("input_output") + "/" + baseNameWithoutTxt(inputFileName);
+    return OutputNames{base + ".tokens", base + ".freq", base + ".hdr", base + ".code", base + ".state"};
+}
+
+// Verify the input file exists and every one of 'outputs' is writable
+static error_type checkFiles(const std::string& inputFileName, const std::vector<std::string>& outputs,
+                             std::string& errorEntity) {
+    if (error_type status; (status = regularFileExistsAndIsAvailable(inputFileName)) != NO_ERROR)
+        return fail(status, inputFileName, errorEntity);
+
+    for (const std::string& outputFileName : outputs) {
+        if (error_type status; (status = canOpenForWriting(outputFileName)) != NO_ERROR)
+            return fail(status, outputFileName, errorEntity);
+    }
+    return NO_ERROR;
+}
+
+// Intern 'token' and count it in 'counts' (indexed by token ID)
+static void countToken(TokenInterner& interner, std::vector<size_t>& counts, std::string_view token) {
+    const uint32_t id = interner.intern(token);
+    if (id == counts.size()) counts.push_back(0);
+    ++counts[id];
+}
+
+// One pass over the input, handing every token to 'onToken' and also
+// writing it to 'tokensFileName', one per line, unless that is empty
+static error_type scanTokens(const std::string& inputFileName, const std::string& tokensFileName,
+                             const std::function<void(std::string_view)>& onToken, std::string& errorEntity) {
+    OutputFile tokensFile;
+    if (error_type status; !tokensFileName.empty() && (status = tokensFile.open(tokensFileName)) != NO_ERROR)
+        return fail(status, tokensFileName, errorEntity);
+
+    std::ostream& tokensOut = tokensFile.stream();
+    auto fileToWords = Scanner(std::filesystem::path(inputFileName));
+    if (error_type status = fileToWords.forEachToken([&](std::string_view token) {
+            onToken(token);
+            if (!tokensFileName.empty()) {
+                tokensOut.write(token.data(), static_cast<std::streamsize>(token.size()));
+                tokensOut.put('\n');
+            }
+        }); status != NO_ERROR)
+        return fail(status, inputFileName, errorEntity);
+    Stats::addFileRead(inputFileName);
+
+    if (tokensFileName.empty()) return NO_ERROR;
+    if (error_type status; (status = tokensFile.close()) != NO_ERROR)
+        return fail(status, tokensFileName, errorEntity);
+    Stats::addFileWritten(tokensFileName);
+    return NO_ERROR;
+}
+
+// Write (word, count) pairs to a .freq file, by count (desc) then word (asc)
+static error_type writeFrequencies(const std::vector<std::pair<std::string, size_t>>& frequencies,
+                                   const std::string& freqFileName, std::string& errorEntity) {
+    PriorityQueue pq;
+    pq.buildQueue(frequencies);
+    if (error_type status; (status = pq.writeToFile(freqFileName)) != NO_ERROR)
+        return fail(status, freqFileName, errorEntity);
+    Stats::addFileWritten(freqFileName);
+    return NO_ERROR;
+}
+
+// Write a shared dictionary (a --train file, or the .hdr of --approx and
+// --hybrid)
+static error_type writeDictionary(const SharedDictionary& dictionary, const std::string& fileName,
+                                  std::string& errorEntity) {
+    OutputFile file;
+    if (error_type status; (status = file.open(fileName)) != NO_ERROR)
+        return fail(status, fileName, errorEntity);
+    if (error_type status; (status = dictionary.write(file.stream())) != NO_ERROR)
+        return fail(status, fileName, errorEntity);
+    if (error_type status; (status = file.close()) != NO_ERROR)
+        return fail(status, fileName, errorEntity);
+    Stats::addFileWritten(fileName);
+    return NO_ERROR;
+}
+
+error_type encodeFile(const Options& options, const std::string& inputFileName,
+                      std::ostream& out, EncodeSummary& summary, std::string& errorEntity) {
+    // Build paths for output files, then verify input file exists and
+    // output files are writable
+    const OutputNames files = outputNames(inputFileName);
+    const std::string& wordTokensFileName = files.tokens;
+    const std::string& freqFileName = files.freq;
+    const std::string& hdrFileName = files.hdr;
+    const std::string& codeFileName = files.code;
+    if (error_type status = checkFiles(inputFileName, {wordTokensFileName, freqFileName, hdrFileName, codeFileName},
+                                       errorEntity); status != NO_ERROR)
+        return status;
+
+    // 2) Scanner: tokenize input file into token IDs
+    //    Each distinct word is interned once, with IDs in order of first
+    //    occurrence, and counted in a flat array indexed by ID. Strings are
+    //    only needed again for the output files.
+    //    With --threads > 1 the parallel front end tokenizes and counts, and
+    //    its tokens are then mapped to IDs. Otherwise, with a second core,
+    //    reading, tokenizing and counting (plus writing .tokens) run as a
+    //    three-stage pipeline (see Scanner::forEachBatch). With --streaming only the counts are
+    //    kept, and .tokens is written while scanning.
+    //    All four outputs are written by the I/O thread (see OutputFile.hpp)
+    //    while the next steps run, and only closed at the end.
+    Stats::Phase phase("scan");
+    OutputFile tokensFile, freqFile, hdrFile, codeFile;
+    TokenInterner interner;
+    std::vector<uint32_t> ids;
+    std::vector<size_t> counts;
+    size_t totalTokens = 0;
+    auto fileToWords = Scanner(std::filesystem::path(inputFileName));
+
+    if (options.streaming) {
+        if (error_type status; (status = tokensFile.open(wordTokensFileName)) != NO_ERROR)
+            return fail(status, wordTokensFileName, errorEntity);
+
+        std::string pending;
+        error_type status = fileToWords.forEachToken([&](std::string_view token) {
+            const uint32_t id = interner.intern(token);
+            if (id == counts.size()) counts.push_back(0);
+            ++counts[id];
+            ++totalTokens;
+            pending.append(token).push_back('\n');
+            if (pending.size() >= (1 << 16)) {
+                tokensFile.stream().write(pending.data(), pending.size());
+                pending.clear();
+            }
+        });
+        if (status != NO_ERROR)
+            return fail(status, inputFileName, errorEntity);
+
+        tokensFile.stream().write(pending.data(), pending.size());
+        if (!tokensFile.stream())
+            return fail(FAILED_TO_WRITE_FILE, wordTokensFileName, errorEntity);
+    } else {
+        const bool pipelined = options.threads == 1 && options.scanPipeline && usePipeline();
+        if (options.threads > 1) {
+            auto parallelFileToWords = ParallelScanner(std::filesystem::path(inputFileName), options.threads);
+            std::vector<std::string_view> words;
+            std::vector<std::pair<std::string, size_t>> sortedCounts;
+            std::vector<std::pair<std::string_view, size_t>> firstSeen;
+            if (error_type status; (status = parallelFileToWords.tokenize(words, sortedCounts, firstSeen)) != NO_ERROR)
+                return fail(status, inputFileName, errorEntity);
+
+            for (const auto& [word, count] : firstSeen) {
+                interner.intern(word);
+                counts.push_back(count);
+            }
+            ids.resize(words.size());
+            runOnThreads(options.threads, [&](size_t t) {
+                for (size_t i = words.size() * t / options.threads; i < words.size() * (t + 1) / options.threads; ++i) {
+                    ids[i] = interner.find(words[i]);
+                }
+            });
+        } else if (pipelined) {
+            // Each batch comes already lowercased and laid out as .tokens
+            // lines, so it is counted and copied out as it arrives
+            if (error_type status; (status = tokensFile.open(wordTokensFileName)) != NO_ERROR)
+                return fail(status, wordTokensFileName, errorEntity);
+
+            error_type status = fileToWords.forEachBatch([&](std::string_view text, const std::vector<size_t>& ends) {
+                size_t begin = 0;
+                for (size_t end : ends) {
+                    const uint32_t id = interner.intern(text.substr(begin, end - begin));
+                    if (id == counts.size()) counts.push_back(0);
+                    ++counts[id];
+                    ids.push_back(id);
+                    begin = end + 1;
+                }
+                tokensFile.stream().write(text.data(), static_cast<std::streamsize>(text.size()));
+            });
+            if (status != NO_ERROR)
+                return fail(status, inputFileName, errorEntity);
+        } else {
+            if (error_type status; (status = fileToWords.tokenize(interner, ids)) != NO_ERROR)
+                return fail(status, inputFileName, errorEntity);
+
+            counts.assign(interner.size(), 0);
+            for (uint32_t id : ids) {
+                ++counts[id];
+            }
+        }
+        totalTokens = ids.size();
+
+        // Write tokens to .tokens file
+        if (!pipelined) {
+            phase.next("write_tokens");
+            if (error_type status; (status = tokensFile.open(wordTokensFileName)) != NO_ERROR)
+                return fail(status, wordTokensFileName, errorEntity);
+            if (error_type status; (status = interner.writeTokens(tokensFile.stream(), ids)) != NO_ERROR)
+                return fail(status, wordTokensFileName, errorEntity);
+        }
+    }
+
+    // 3) BST: insert each distinct word once, in first-occurrence (ID) order,
+    //    with its count. The tree shape and counts are the same as inserting
+    //    every token.
+    phase.next("bst_build");
+    BST bst(options.counter);
+    for (uint32_t id = 0; id < interner.size(); ++id) {
+        bst.insert(interner.word(id), counts[id]);
+    }
+    
+    // Get frequency data
+    std::vector<std::pair<std::string, size_t>> frequencies = bst.getFrequencies();
+    
+    // 4) Print BST measures to stdout
+    size_t uniqueWords = bst.getUniqueWords();
+    int bstHeight = bst.getHeight();
+    size_t minFreq, maxFreq;
+    bst.getMinMaxFrequency(minFreq, maxFreq);
+    
+    if (bst.backend() == CounterBackend::Hash) {
+        out << "Hash max probe length: " << bstHeight << '\n';
+    } else {
+        out << "BST height: " << bstHeight << '\n';
+    }
+    out << "BST unique words: " << uniqueWords << '\n';
+    out << "Total tokens: " << totalTokens << '\n';
+    out << "Min frequency: " << minFreq << '\n';
+    out << "Max frequency: " << maxFreq << '\n';
+
+    // 5) PriorityQueue: sort by count (desc) then word (asc), write to .freq
+    phase.next("sort");
+    PriorityQueue pq;
+    pq.buildQueue(frequencies);
+    
+    phase.next("freq_write");
+    if (error_type status; (status = freqFile.open(freqFileName)) != NO_ERROR)
+        return fail(status, freqFileName, errorEntity);
+    if (error_type status; (status = pq.write(freqFile.stream())) != NO_ERROR)
+        return fail(status, freqFileName, errorEntity);
+
+    // ============================================================================
+    // *** NEW FOR PHASE 3: Build Huffman Tree and Encode ***
+    // ============================================================================
+    
+    // 6) Build Huffman tree from frequencies (and the canonical code on top)
+    phase.next("huffman_build");
+    HuffmanTree huffman;
+    CanonicalCode canonical;
+    std::vector<std::pair<std::string, int>> limitedLengths;
+    if (error_type status; (status = buildCode(options, frequencies, hdrFileName, huffman, canonical,
+                                               limitedLengths, errorEntity)) != NO_ERROR)
+        return status;
+    
+    // Print Huffman tree height
+    int huffmanHeight = huffman.getHeight();
+    out << "Huffman tree height: " << huffmanHeight << '\n';
+    
+    // 7) Write header file (.hdr) - codebook with word->code mappings
+    phase.next("header");
+    if (error_type status; (status = hdrFile.open(hdrFileName)) != NO_ERROR)
+        return fail(status, hdrFileName, errorEntity);
+    if (error_type status; (status = writeCodeHeader(options, huffman, canonical, hdrFile.stream())) != NO_ERROR)
+        return fail(status, hdrFileName, errorEntity);
+    
+    // 8) Encode tokens and write to .code file (ASCII, packed with --binary,
+    //    or the block container with --block-tokens / --block-bytes)
+    phase.next("encode");
+    const bool blocks = options.blockTokens > 0 || options.blockBytes > 0;
+    if (error_type status; (status = codeFile.open(codeFileName)) != NO_ERROR)
+        return fail(status, codeFileName, errorEntity);
+    
+    // The codebook is reordered by token ID, so the encoder indexes codes by
+    // ID and never looks a string up per token
+    std::vector<std::pair<std::string, std::string>> codebook;
+    getCodebook(options, huffman, canonical, codebook);
+    std::vector<std::pair<std::string, std::string>> codebookById(interner.size());
+    for (auto& entry : codebook) {
+        if (uint32_t id = interner.find(entry.first); id != TokenInterner::kNoId) {
+            codebookById[id] = std::move(entry);
+        }
+    }
+    
+    const TokenEncoder::Format format = blocks ? TokenEncoder::Format::Blocks
+                                      : options.binary ? TokenEncoder::Format::Binary
+                                                       : TokenEncoder::Format::Ascii;
+    TokenEncoder encoder(codebookById, codeFile.stream(), format, 80, options.blockTokens,
+                         options.blockBytes);
+    error_type encodeStatus = NO_ERROR;
+    if (options.streaming) {
+        // Second pass over the file, encoding each token as it is scanned
+        error_type scanStatus = fileToWords.forEachToken([&](std::string_view token) {
+            if (encodeStatus == NO_ERROR) encodeStatus = encoder.putId(interner.find(token));
+        });
+        if (scanStatus != NO_ERROR)
+            return fail(scanStatus, inputFileName, errorEntity);
+        if (encodeStatus == NO_ERROR) encodeStatus = encoder.finish();
+    } else {
+        // Token IDs are in memory: encode them on all threads at once
+        encodeStatus = encoder.encodeIds(ids, options.threads);
+    }
+    if (encodeStatus != NO_ERROR) {
+        return fail(encodeStatus, codeFileName, errorEntity);
+    }
+    
+    // 9) Calculate and print additional statistics
+    //    Both totals follow from the counts: every occurrence of a word has
+    //    the same length and the same code.
+    phase.next("summary");
+    std::vector<int> treeLength(interner.size(), 0);
+    std::vector<std::pair<std::string, int>> codeLengths;
+    huffman.getCodeLengths(codeLengths);
+    for (const auto& [word, length] : codeLengths) {
+        if (uint32_t id = interner.find(word); id != TokenInterner::kNoId) {
+            treeLength[id] = length;
+        }
+    }
+    
+    size_t totalLetters = 0;
+    size_t totalBits = 0;
+    for (uint32_t id = 0; id < interner.size(); ++id) {
+        totalLetters += interner.word(id).length() * counts[id];
+        totalBits += static_cast<size_t>(treeLength[id]) * counts[id];
+    }
+    out << "Total letters in words: " << totalLetters << '\n';
+    out << "Total encoded bits: " << totalBits << '\n';
+    
+    // With --max-code-len, what the limit costs against the tree's codes
+    if (options.maxCodeLength > 0) {
+        size_t limitedBits = 0;
+        int longest = 0;
+        for (const auto& [word, length] : limitedLengths) {
+            if (uint32_t id = interner.find(word); id != TokenInterner::kNoId) {
+                limitedBits += static_cast<size_t>(length) * counts[id];
+            }
+            longest = std::max(longest, length);
+        }
+        
+        const double tokens = totalTokens > 0 ? static_cast<double>(totalTokens) : 1.0;
+        const double treeAverage = totalBits / tokens;
+        const double limitedAverage = limitedBits / tokens;
+        out << "Length-limited longest code: " << longest << " (limit " << options.maxCodeLength << ")\n";
+        out << "Length-limited encoded bits: " << limitedBits << '\n';
+        out << std::fixed << std::setprecision(4)
+                  << "Average code length: " << limitedAverage << " bits (tree: " << treeAverage
+                  << ", cost " << std::showpos << (treeAverage > 0 ? 100.0 * (limitedAverage - treeAverage) / treeAverage : 0.0)
+                  << std::noshowpos << "%)\n";
+    }
+    
+    // *** END NEW FOR PHASE 3 ***
+    // ============================================================================
+
+    // Wait for the I/O thread to finish the outputs
+    phase.next("close");
+    if (error_type status; (status = tokensFile.close()) != NO_ERROR)
+        return fail(status, wordTokensFileName, errorEntity);
+
+    if (error_type status; (status = freqFile.close()) != NO_ERROR)
+        return fail(status, freqFileName, errorEntity);
+
+    if (error_type status; (status = hdrFile.close()) != NO_ERROR)
+        return fail(status, hdrFileName, errorEntity);
+
+    if (error_type status; (status = codeFile.close()) != NO_ERROR)
+        return fail(status, codeFileName, errorEntity);
+    phase.end();
+
+    Stats::addFileRead(inputFileName);
+    if (options.streaming) {
+        Stats::addFileRead(inputFileName);   // read a second time to encode
+    }
+    for (const std::string& outputFileName : {wordTokensFileName, freqFileName, hdrFileName, codeFileName}) {
+        Stats::addFileWritten(outputFileName);
+    }
+
+    summary.totalTokens = totalTokens;
+    summary.uniqueWords = uniqueWords;
+    summary.totalLetters = totalLetters;
+    summary.totalBits = totalBits;
+    return NO_ERROR;
+}
+
+error_type trainDictionary(const Options& options, const std::string& inputFileName,
+                           std::ostream& out, std::string& errorEntity) {
+    if (error_type status = checkFiles(inputFileName, {options.trainFileName}, errorEntity); status != NO_ERROR)
+        return status;
+
+    // Count every word once, as in the streaming encoder's first pass
+    Stats::Phase phase("scan");
+    TokenInterner interner;
+    std::vector<size_t> counts;
+    size_t totalTokens = 0;
+    if (error_type status = scanTokens(inputFileName, "", [&](std::string_view token) {
+            countToken(interner, counts, token);
+            ++totalTokens;
+        }, errorEntity); status != NO_ERROR)
+        return status;
+
+    phase.next("train");
+    std::vector<std::pair<std::string, size_t>> frequencies;
+    frequencies.reserve(interner.size());
+    for (uint32_t id = 0; id < interner.size(); ++id) {
+        frequencies.emplace_back(std::string(interner.word(id)), counts[id]);
+    }
+    SharedDictionary dictionary;
+    if (error_type status; (status = dictionary.train(frequencies)) != NO_ERROR)
+        return fail(status, options.trainFileName, errorEntity);
+
+    phase.next("write_dictionary");
+    if (error_type status = writeDictionary(dictionary, options.trainFileName, errorEntity); status != NO_ERROR)
+        return status;
+    phase.end();
+
+    out << "Training tokens: " << totalTokens << '\n';
+    out << "Training unique words: " << interner.size() << '\n';
+    out << "Dictionary words: " << dictionary.size() << '\n';
+    return NO_ERROR;
+}
+
+error_type loadDictionary(const std::string& fileName, SharedDictionary& dictionary) {
+    if (error_type status = regularFileExistsAndIsAvailable(fileName); status != NO_ERROR) {
+        return status;
+    }
+    std::ifstream dictionaryFile(fileName);
+    if (!dictionaryFile.is_open()) {
+        return UNABLE_TO_OPEN_FILE;
+    }
+    Stats::addFileRead(fileName);
+    return dictionary.read(dictionaryFile);
+}
+
+error_type encodeWithDictionary(const Options& options, const SharedDictionary& dictionary,
+                                const std::string& inputFileName, std::ostream& out,
+                                EncodeSummary& summary, std::string& errorEntity) {
+    const std::string codeFileName = outputNames(inputFileName).code;
+    if (error_type status = checkFiles(inputFileName, {codeFileName}, errorEntity); status != NO_ERROR)
+        return status;
+
+    // One pass: every token is looked up in the frozen dictionary and coded
+    // right away (escaped and spelled out if it is not in it)
+    Stats::Phase phase("encode");
+    OutputFile codeFile;
+    if (error_type status; (status = codeFile.open(codeFileName)) != NO_ERROR)
+        return fail(status, codeFileName, errorEntity);
+
+    TokenEncoder encoder(dictionary.codes(), codeFile.stream(),
+                         options.binary ? TokenEncoder::Format::Binary : TokenEncoder::Format::Ascii);
+    size_t totalTokens = 0;
+    size_t totalLetters = 0;
+    size_t escapedTokens = 0;
+    error_type encodeStatus = NO_ERROR;
+    auto fileToWords = Scanner(std::filesystem::path(inputFileName));
+    if (error_type status = fileToWords.forEachToken([&](std::string_view token) {
+            ++totalTokens;
+            totalLetters += token.size();
+            if (!dictionary.putToken(token, [&](uint32_t id) {
+                    if (encodeStatus == NO_ERROR) encodeStatus = encoder.putId(id);
+                })) {
+                ++escapedTokens;
+            }
+        }); status != NO_ERROR)
+        return fail(status, inputFileName, errorEntity);
+    if (encodeStatus == NO_ERROR) encodeStatus = encoder.finish();
+    if (encodeStatus != NO_ERROR)
+        return fail(encodeStatus, codeFileName, errorEntity);
+    if (error_type status; (status = codeFile.close()) != NO_ERROR)
+        return fail(status, codeFileName, errorEntity);
+    phase.end();
+    Stats::addFileRead(inputFileName);
+    Stats::addFileWritten(codeFileName);
+
+    out << "Dictionary words: " << dictionary.size() << '\n';
+    out << "Total tokens: " << totalTokens << '\n';
+    out << "Escaped tokens: " << escapedTokens << '\n';
+    out << "Total letters in words: " << totalLetters << '\n';
+    out << "Total encoded bits: " << encoder.totalBits() << '\n';
+
+    summary.totalTokens = totalTokens;
+    summary.totalLetters = totalLetters;
+    summary.totalBits = encoder.totalBits();
+    return NO_ERROR;
+}
+
+// Bytes of a .code file holding 'bits' code bits: ASCII, 80 to a line (a
+// lone line break if empty), or packed with the binary trailer
+static uint64_t codeFileBytes(uint64_t bits, bool binary) {
+    if (binary) return (bits + 7) / 8 + BitWriter::kTrailerBytes;
+    return bits > 0 ? bits + (bits + 79) / 80 : 1;
+}
+
+bool isDictionaryFile(const std::string& fileName) {
+    std::ifstream file(fileName);
+    std::string line;
+    return std::getline(file, line) && line == "#dictionary 1";
+}
+
+// Split counted words: those seen at least 'minCount' times are kept; the
+// others are escaped, adding to 'escapeCount' and 'charCounts' (which may
+// already hold other escaped tokens). 'kept' gets the kept words and their
+// counts.
+static void splitEscapes(const TokenInterner& interner, const std::vector<size_t>& counts, size_t minCount,
+                         size_t& escapeCount, std::array<size_t, 256>& charCounts,
+                         std::vector<std::pair<std::string, size_t>>& kept) {
+    kept.clear();
+    for (uint32_t id = 0; id < interner.size(); ++id) {
+        if (counts[id] >= minCount) {
+            kept.emplace_back(std::string(interner.word(id)), counts[id]);
+            continue;
+        }
+        escapeCount += counts[id];
+        for (unsigned char c : interner.word(id)) {
+            charCounts[c] += counts[id];
+        }
+    }
+}
+
+// A shared dictionary over counted words: the words splitEscapes() keeps
+// get codes, the others are escaped
+static error_type buildEscapeDictionary(const TokenInterner& interner, const std::vector<size_t>& counts,
+                                        size_t minCount, size_t& escapeCount, std::array<size_t, 256>& charCounts,
+                                        std::vector<std::pair<std::string, size_t>>& kept,
+                                        SharedDictionary& dictionary) {
+    splitEscapes(interner, counts, minCount, escapeCount, charCounts, kept);
+    return dictionary.build(kept, escapeCount, charCounts);
+}
+
+error_type encodeApproximate(const Options& options, const std::string& inputFileName,
+                             std::ostream& out, EncodeSummary& summary, std::string& errorEntity) {
+    const OutputNames files = outputNames(inputFileName);
+    if (error_type status = checkFiles(inputFileName, {files.tokens, files.freq, files.hdr}, errorEntity);
+        status != NO_ERROR)
+        return status;
+
+    // 1) First pass: the SpaceSaving table (and the sketch) pick the
+    //    frequent words in bounded memory, and .tokens is written as the
+    //    tokens go by
+    Stats::Phase phase("scan");
+    std::unique_ptr<CountMinSketch> sketch;
+    if (options.sketchWidth > 0) {
+        sketch = std::make_unique<CountMinSketch>(options.sketchWidth);
+    }
+    SpaceSaving heavyHitters(options.approxWords, sketch.get());
+    if (error_type status = scanTokens(inputFileName, files.tokens,
+                                       [&](std::string_view token) { heavyHitters.add(token); }, errorEntity);
+        status != NO_ERROR)
+        return status;
+
+    // 2) Second pass: exact counts of the tracked words, and of the other
+    //    (escaped) tokens and their characters
+    phase.next("recount");
+    TokenInterner tracked;
+    for (const SpaceSaving::Entry& entry : heavyHitters.entries()) {
+        tracked.intern(entry.word);
+    }
+    std::vector<size_t> counts(tracked.size(), 0);
+    std::array<size_t, 256> charCounts{};
+    size_t escapeCount = 0;
+    if (error_type status = scanTokens(inputFileName, "", [&](std::string_view token) {
+            if (const uint32_t id = tracked.find(token); id != TokenInterner::kNoId) {
+                ++counts[id];
+                return;
+            }
+            ++escapeCount;
+            for (unsigned char c : token) {
+                ++charCounts[c];
+            }
+        }, errorEntity); status != NO_ERROR)
+        return status;
+
+    // 3) Tracked words seen fewer than kMinCount times are escaped as well,
+    //    as --train does
+    phase.next("build");
+    std::vector<std::pair<std::string, size_t>> kept;
+    SharedDictionary dictionary;
+    if (error_type status; (status = buildEscapeDictionary(tracked, counts, SharedDictionary::kMinCount, escapeCount,
+                                                           charCounts, kept, dictionary)) != NO_ERROR)
+        return fail(status, files.hdr, errorEntity);
+
+    // .freq holds the coded words and the escape, with the counts they are
+    // coded with; .hdr is the dictionary
+    phase.next("freq_write");
+    kept.emplace_back(std::string(SharedDictionary::kEscape), SharedDictionary::codedEscapeCount(escapeCount));
+    if (error_type status = writeFrequencies(kept, files.freq, errorEntity); status != NO_ERROR)
+        return status;
+
+    phase.next("header");
+    if (error_type status = writeDictionary(dictionary, files.hdr, errorEntity); status != NO_ERROR)
+        return status;
+    phase.end();
+
+    out << "SpaceSaving entries: " << options.approxWords;
+    if (sketch) {
+        out << " (Count-Min sketch " << CountMinSketch::kDepth << " x " << sketch->width() << ")";
+    }
+    out << '\n';
+
+    // 4) Third pass: encode against the dictionary, as --dict does
+    if (error_type status; (status = encodeWithDictionary(options, dictionary, inputFileName, out,
+                                                          summary, errorEntity)) != NO_ERROR)
+        return status;
+
+    // 5) --compare-exact: what the exact path (every word in the BST, and
+    //    the Huffman tree over BST::getFrequencies) writes
+    if (options.compareExact) {
+        Stats::Phase exactPhase("exact");
+        TokenInterner interner;
+        std::vector<size_t> exactCounts;
+        if (error_type status = scanTokens(inputFileName, "",
+                                           [&](std::string_view token) { countToken(interner, exactCounts, token); },
+                                           errorEntity);
+            status != NO_ERROR)
+            return status;
+
+        BST bst(options.counter);
+        for (uint32_t id = 0; id < interner.size(); ++id) {
+            bst.insert(interner.word(id), exactCounts[id]);
+        }
+        HuffmanTree huffman;
+        huffman.buildFromFrequencies(bst.getFrequencies());
+        std::vector<std::pair<std::string, int>> codeLengths;
+        huffman.getCodeLengths(codeLengths);
+        size_t exactBits = 0;
+        for (const auto& [word, length] : codeLengths) {
+            if (uint32_t id = interner.find(word); id != TokenInterner::kNoId) {
+                exactBits += static_cast<size_t>(length) * exactCounts[id];
+            }
+        }
+        std::ostringstream exactHeader;
+        if (error_type status = huffman.writeHeader(exactHeader); status != NO_ERROR)
+            return fail(status, files.hdr, errorEntity);
+        exactPhase.end();
+
+        // The vocabulary is mostly saved in the header, so the files are
+        // compared as well as the code streams
+        uint64_t approximateBytes = 0;
+        for (const std::string& fileName : {files.hdr, files.code}) {
+            std::error_code ec;
+            const uintmax_t size = std::filesystem::file_size(fileName, ec);
+            if (ec)
+                return fail(FAILED_TO_READ_FILE, fileName, errorEntity);
+            approximateBytes += size;
+        }
+        const uint64_t exactBytes = exactHeader.str().size() + codeFileBytes(exactBits, options.binary);
+        auto percent = [](double value, double base) { return base > 0 ? 100.0 * (value - base) / base : 0.0; };
+        out << "Exact unique words: " << interner.size() << '\n';
+        out << "Exact encoded bits: " << exactBits << '\n';
+        out << "Exact .hdr + .code bytes: " << exactBytes << '\n';
+        out << "Approximate .hdr + .code bytes: " << approximateBytes << '\n';
+        const std::ios::fmtflags flags = out.flags();
+        out << std::fixed << std::setprecision(4) << std::showpos
+            << "Compression lost (code bits only): " << percent(summary.totalBits, exactBits) << "% ("
+            << static_cast<long long>(summary.totalBits) - static_cast<long long>(exactBits) << " bits)\n"
+            << "Compression lost (.hdr + .code): " << percent(approximateBytes, exactBytes) << "% ("
+            << static_cast<long long>(approximateBytes) - static_cast<long long>(exactBytes) << " bytes)\n";
+        out.flags(flags);
+    }
+    summary.uniqueWords = dictionary.size();
+    return NO_ERROR;
+}
+
+// --hybrid: the words seen at least 'threshold' times get codes, the others
+// are escaped
+static error_type buildHybridDictionary(const TokenInterner& interner, const std::vector<size_t>& counts,
+                                        size_t threshold, SharedDictionary& dictionary) {
+    std::vector<std::pair<std::string, size_t>> kept;
+    std::array<size_t, 256> charCounts{};
+    size_t escapeCount = 0;
+    return buildEscapeDictionary(interner, counts, threshold, escapeCount, charCounts, kept, dictionary);
+}
+
+// Exact .hdr plus .code bytes of --hybrid with 'threshold'
+static error_type measureHybrid(const TokenInterner& interner, const std::vector<size_t>& counts,
+                                size_t threshold, bool binary, uint64_t& bytes) {
+    std::vector<std::pair<std::string, size_t>> kept;
+    std::array<size_t, 256> charCounts{};
+    size_t escapeCount = 0;
+    splitEscapes(interner, counts, threshold, escapeCount, charCounts, kept);
+    uint64_t headerBytes = 0;
+    uint64_t codeBits = 0;
+    if (error_type status = SharedDictionary::measure(kept, escapeCount, charCounts, headerBytes, codeBits);
+        status != NO_ERROR)
+        return status;
+    bytes = headerBytes + codeFileBytes(codeBits, binary);
+    return NO_ERROR;
+}
+
+// Every useful threshold, from keeping no word (the largest count plus one)
+// down to keeping them all (1), with a lower bound on its .hdr + .code
+// bytes. No prefix code beats the entropy, so the code bits are at least
+// that of the word stream (kept words and escapes) plus that of the
+// character stream (escaped characters and one end symbol per escape). A
+// kept word's header line ("shared suffix length") takes at least 5 bytes
+// plus its length less the prefix it shares with the word before it in the
+// whole sorted vocabulary, as no kept word before it shares more. One sweep
+// down the counts moves each word from the escaped side to the kept side.
+static std::vector<std::pair<size_t, double>> boundHybridThresholds(const TokenInterner& interner,
+                                                                    const std::vector<size_t>& counts,
+                                                                    bool binary) {
+    std::vector<uint32_t> order(interner.size());
+    for (uint32_t id = 0; id < order.size(); ++id) order[id] = id;
+    std::sort(order.begin(), order.end(),
+              [&](uint32_t a, uint32_t b) { return interner.word(a) < interner.word(b); });
+    std::vector<size_t> lineBytes(interner.size());
+    for (size_t i = 0; i < order.size(); ++i) {
+        const std::string_view word = interner.word(order[i]);
+        size_t shared = 0;
+        if (i > 0) {
+            const std::string_view previous = interner.word(order[i - 1]);
+            const size_t limit = std::min(previous.size(), word.size());
+            while (shared < limit && previous[shared] == word[shared]) ++shared;
+        }
+        lineBytes[order[i]] = word.size() - shared + 5;
+    }
+    std::sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) { return counts[a] > counts[b]; });
+
+    // Everything escaped to start with
+    size_t totalTokens = 0;
+    std::array<size_t, 256> charCounts{};
+    for (uint32_t id = 0; id < interner.size(); ++id) {
+        totalTokens += counts[id];
+        for (unsigned char c : interner.word(id)) {
+            charCounts[c] += counts[id];
+        }
+    }
+    size_t escapeCount = totalTokens;
+    double keptBits = 0;
+    double headerBytes = 0;
+    auto entropyBits = [](double count, double total) { return count > 0 ? count * std::log2(total / count) : 0.0; };
+    auto bound = [&] {
+        double characters = static_cast<double>(escapeCount);   // one end symbol per escape
+        for (size_t count : charCounts) characters += static_cast<double>(count);
+        double bits = keptBits + entropyBits(static_cast<double>(escapeCount), static_cast<double>(totalTokens)) +
+                      entropyBits(static_cast<double>(escapeCount), characters);
+        for (size_t count : charCounts) bits += entropyBits(static_cast<double>(count), characters);
+        return headerBytes + (binary ? bits / 8 + BitWriter::kTrailerBytes : bits * 81 / 80);
+    };
+
+    std::vector<std::pair<size_t, double>> candidates;
+    candidates.emplace_back(order.empty() ? 1 : counts[order.front()] + 1, bound());
+    for (size_t i = 0; i < order.size();) {
+        const size_t count = counts[order[i]];
+        for (; i < order.size() && counts[order[i]] == count; ++i) {
+            escapeCount -= count;
+            keptBits += entropyBits(static_cast<double>(count), static_cast<double>(totalTokens));
+            headerBytes += static_cast<double>(lineBytes[order[i]]);
+            for (unsigned char c : interner.word(order[i])) {
+                charCounts[c] -= count;
+            }
+        }
+        candidates.emplace_back(count, bound());
+    }
+    return candidates;
+}
+
+error_type encodeHybrid(const Options& options, const std::string& inputFileName,
+                        std::ostream& out, EncodeSummary& summary, std::string& errorEntity) {
+    const OutputNames files = outputNames(inputFileName);
+    if (error_type status = checkFiles(inputFileName, {files.tokens, files.freq, files.hdr}, errorEntity);
+        status != NO_ERROR)
+        return status;
+
+    // 1) Count every word, writing .tokens as the tokens go by
+    Stats::Phase phase("scan");
+    TokenInterner interner;
+    std::vector<size_t> counts;
+    if (error_type status = scanTokens(inputFileName, files.tokens,
+                                       [&](std::string_view token) { countToken(interner, counts, token); },
+                                       errorEntity);
+        status != NO_ERROR)
+        return status;
+
+    // 2) .freq, the same as the default run's
+    phase.next("freq_write");
+    std::vector<std::pair<std::string, size_t>> frequencies;
+    frequencies.reserve(interner.size());
+    for (uint32_t id = 0; id < interner.size(); ++id) {
+        frequencies.emplace_back(std::string(interner.word(id)), counts[id]);
+    }
+    if (error_type status = writeFrequencies(frequencies, files.freq, errorEntity); status != NO_ERROR)
+        return status;
+    frequencies = {};
+
+    // 3) The threshold. Candidates are measured exactly from the lowest
+    //    bound up, until the next bound is no smaller than the smallest size
+    //    measured: no candidate left can beat it, so the threshold found
+    //    gives the smallest .hdr + .code of them all.
+    //
+    //    A count threshold stands in for escaping each word whose header
+    //    line costs more than it saves: what a word saves depends on the
+    //    codes of all the others, while thresholds are found by one sweep
+    //    down the counts and are few enough to search exactly. A word's
+    //    length still counts, through the header bytes.
+    phase.next("threshold");
+    std::vector<std::pair<size_t, double>> candidates = boundHybridThresholds(interner, counts, options.binary);
+    std::stable_sort(candidates.begin(), candidates.end(),
+                     [](const auto& a, const auto& b) { return a.second < b.second; });
+    size_t threshold = candidates.front().first;
+    uint64_t thresholdBytes = UINT64_MAX;
+    size_t measured = 0;
+    for (const auto& [candidate, bound] : candidates) {
+        if (bound >= static_cast<double>(thresholdBytes)) break;
+        uint64_t bytes = 0;
+        if (error_type status = measureHybrid(interner, counts, candidate, options.binary, bytes);
+            status != NO_ERROR)
+            return fail(status, files.hdr, errorEntity);
+        ++measured;
+        if (bytes < thresholdBytes || (bytes == thresholdBytes && candidate > threshold)) {
+            threshold = candidate;
+            thresholdBytes = bytes;
+        }
+    }
+    SharedDictionary dictionary;
+    if (error_type status; (status = buildHybridDictionary(interner, counts, threshold, dictionary)) != NO_ERROR)
+        return fail(status, files.hdr, errorEntity);
+
+    phase.next("header");
+    if (error_type status = writeDictionary(dictionary, files.hdr, errorEntity); status != NO_ERROR)
+        return status;
+    phase.end();
+
+    out << "Hybrid threshold: " << threshold << " (" << measured << " of " << candidates.size()
+        << " thresholds measured)\n";
+
+    // 4) Encode against the dictionary, as --dict does
+    if (error_type status; (status = encodeWithDictionary(options, dictionary, inputFileName, out,
+                                                          summary, errorEntity)) != NO_ERROR)
+        return status;
+
+    std::error_code ec;
+    out << "Header bytes: " << std::filesystem::file_size(files.hdr, ec) << '\n';
+    summary.uniqueWords = interner.size();
+    return NO_ERROR;
+}
+
+error_type encodeAdaptive(const Options& options, const std::string& inputFileName,
+                          std::ostream& out, EncodeSummary& summary, std::string& errorEntity) {
+    const std::string codeFileName = outputNames(inputFileName).code;
+    const int input = ::open(inputFileName.c_str(), O_RDONLY);
+    if (input < 0)
+        return fail(errno == ENOENT ? FILE_NOT_FOUND : UNABLE_TO_OPEN_FILE, inputFileName, errorEntity);
+
+    OutputFile codeFile;
+    if (error_type status; (status = codeFile.open(codeFileName)) != NO_ERROR) {
+        ::close(input);
+        return fail(status, codeFileName, errorEntity);
+    }
+
+    // One pass: each token is coded as soon as a read completes it, and
+    // what is coded is handed to the I/O thread after every read
+    Stats::Phase phase("encode");
+    const std::vector<std::pair<uint64_t, int>> noCodebook;
+    TokenEncoder encoder(noCodebook, codeFile.stream(),
+                         options.binary ? TokenEncoder::Format::Binary : TokenEncoder::Format::Ascii);
+    AdaptiveCoder coder;
+    size_t totalTokens = 0;
+    size_t totalLetters = 0;
+    error_type flushStatus = NO_ERROR;
+    error_type scanStatus = Scanner::forEachTokenRead(input,
+        [&](std::string_view token) {
+            ++totalTokens;
+            totalLetters += token.size();
+            coder.putToken(token, [&](uint64_t code, int length) { encoder.putCode(code, length); });
+        },
+        [&]() {
+            if (flushStatus == NO_ERROR) flushStatus = encoder.flush();
+        });
+    ::close(input);
+    if (scanStatus != NO_ERROR)
+        return fail(scanStatus, inputFileName, errorEntity);
+    if (flushStatus == NO_ERROR) flushStatus = encoder.finish();
+    if (flushStatus != NO_ERROR)
+        return fail(flushStatus, codeFileName, errorEntity);
+    if (error_type status; (status = codeFile.close()) != NO_ERROR)
+        return fail(status, codeFileName, errorEntity);
+    phase.end();
+    Stats::addFileRead(inputFileName);
+    Stats::addFileWritten(codeFileName);
+
+    out << "Total tokens: " << totalTokens << '\n';
+    out << "Unique words: " << coder.size() << '\n';
+    out << "Total letters in words: " << totalLetters << '\n';
+    out << "Total encoded bits: " << encoder.totalBits() << '\n';
+
+    summary.totalTokens = totalTokens;
+    summary.uniqueWords = coder.size();
+    summary.totalLetters = totalLetters;
+    summary.totalBits = encoder.totalBits();
+    return NO_ERROR;
+}
+
+// --append keeps input_output/<base>.state next to the other outputs: how
+// far the input has been scanned, and enough to check that neither the
+// input before that point nor the outputs have changed since.
+struct AppendState {
+    uint64_t bytes = 0;        // input bytes scanned so far
+    uint64_t tailBegin = 0;    // start of the non-separator run ending at 'bytes' (= bytes if none)
+    uint64_t tailTokens = 0;   // tokens scanned from [tailBegin, bytes)
+    uint32_t crc = 0;          // CRC-32 of the last kAppendCheckedBytes bytes before 'bytes'
+    uint64_t tokensBytes = 0;  // .tokens and .code sizes when the state was written
+    uint64_t codeBytes = 0;
+};
+
+static constexpr uint64_t kAppendCheckedBytes = 4096;
+static constexpr const char* kAppendStateMagic = "#append 1";
+
+static uint32_t appendChecksum(const char* data, uint64_t bytes) {
+    const uint64_t first = bytes > kAppendCheckedBytes ? bytes - kAppendCheckedBytes : 0;
+    return BlockIndex::crc32(reinterpret_cast<const unsigned char*>(data) + first, bytes - first);
+}
+
+static uint64_t fileSizeOrZero(const std::string& fileName) {
+    std::error_code error;
+    const auto size = std::filesystem::file_size(fileName, error);
+    return error ? 0 : static_cast<uint64_t>(size);
+}
+
+// State for input bytes [0, size). A token run that reaches the end may
+// still grow, so the next run starts over from its first byte.
+static error_type describeInput(const std::string& inputFileName, const char* data, uint64_t size,
+                                AppendState& state) {
+    state.bytes = size;
+    state.tailBegin = size;
+    while (state.tailBegin > 0 && charClass(data[state.tailBegin - 1]) != CC_SEPARATOR) {
+        --state.tailBegin;
+    }
+    state.tailTokens = 0;
+    state.crc = appendChecksum(data, size);
+    if (state.tailBegin == size) return NO_ERROR;
+
+    return Scanner(std::filesystem::path(inputFileName))
+        .forEachTokenInRange(state.tailBegin, size, [&](std::string_view) { ++state.tailTokens; });
+}
+
+static bool readAppendState(const std::string& fileName, AppendState& state) {
+    std::ifstream in(fileName);
+    std::string magic;
+    return std::getline(in, magic) && magic == kAppendStateMagic &&
+           in >> state.bytes >> state.tailBegin >> state.tailTokens >> state.crc >> state.tokensBytes >> state.codeBytes &&
+           state.tailBegin <= state.bytes;
+}
+
+static error_type writeAppendState(const std::string& fileName, const AppendState& state) {
+    std::ofstream out(fileName, std::ios::out | std::ios::trunc);
+    if (!out.is_open()) {
+        return UNABLE_TO_OPEN_FILE_FOR_WRITING;
+    }
+    out << kAppendStateMagic << '\n'
+        << state.bytes << ' ' << state.tailBegin << ' ' << state.tailTokens << ' ' << state.crc << ' '
+        << state.tokensBytes << ' ' << state.codeBytes << '\n';
+    if (!out) return FAILED_TO_WRITE_FILE;
+    return NO_ERROR;
+}
+
+// The (word, count) lines of a .freq file
+static bool readFrequencies(const std::string& freqFileName,
+                            std::map<std::string, size_t, std::less<>>& counts) {
+    std::ifstream in(freqFileName);
+    if (!in.is_open()) return false;
+    std::string word;
+    size_t count;
+    while (in >> word >> count) {
+        counts[word] += count;
+    }
+    return in.eof();
+}
+
+// Split 'text' into its '\n'-terminated lines
+static void splitLines(std::string_view text, std::vector<std::string_view>& lines) {
+    size_t begin = 0;
+    for (size_t end; (end = text.find('\n', begin)) != std::string_view::npos; begin = end + 1) {
+        lines.push_back(text.substr(begin, end - begin));
+    }
+}
+
+// Cut the unfinished last line (ASCII, wrapped at 80) or byte (binary) off
+// an existing .code file, for TokenEncoder::resume(). False, with the file
+// untouched, if it is not a stream of that format and must be rewritten.
+static bool cutCodeTail(const std::string& codeFileName, TokenEncoder::Format format,
+                        std::string& pending, uint64_t& bitsBefore) {
+    constexpr uint64_t kWrap = 80;
+    std::ifstream in(codeFileName, std::ios::binary);
+    const uint64_t size = fileSizeOrZero(codeFileName);
+    uint64_t keep = 0;
+    pending.clear();
+
+    if (format == TokenEncoder::Format::Binary) {
+        unsigned char trailer[BitWriter::kTrailerBytes];
+        if (size < BitWriter::kTrailerBytes ||
+            !in.seekg(static_cast<std::streamoff>(size - BitWriter::kTrailerBytes)) ||
+            !in.read(reinterpret_cast<char*>(trailer), sizeof(trailer)) ||
+            std::memcmp(trailer + 8, BitWriter::kMagic, sizeof(BitWriter::kMagic)) != 0) {
+            return false;
+        }
+        bitsBefore = 0;
+        for (int i = 7; i >= 0; --i) {
+            bitsBefore = (bitsBefore << 8) | trailer[i];
+        }
+        if ((bitsBefore + 7) / 8 + BitWriter::kTrailerBytes != size) return false;
+
+        keep = bitsBefore / 8;
+        if (const int partial = static_cast<int>(bitsBefore % 8); partial > 0) {
+            char last;
+            if (!in.seekg(static_cast<std::streamoff>(keep)) || !in.get(last)) return false;
+            for (int i = 0; i < partial; ++i) {
+                pending += (static_cast<unsigned char>(last) >> (7 - i)) & 1 ? '1' : '0';
+            }
+        }
+    } else {
+        // Full lines are kWrap bits and a newline; an empty stream is a lone newline
+        const uint64_t tailBytes = std::min(size, kWrap + 2);
+        std::string tail(tailBytes, '\0');
+        if (size == 0 || !in.seekg(static_cast<std::streamoff>(size - tailBytes)) ||
+            !in.read(tail.data(), static_cast<std::streamsize>(tailBytes)) || tail.back() != '\n') {
+            return false;
+        }
+        std::string_view line(tail.data(), tail.size() - 1);
+        if (const size_t newline = line.rfind('\n'); newline != std::string_view::npos) {
+            line.remove_prefix(newline + 1);
+        } else if (tailBytes < size) {
+            return false;   // a line longer than kWrap
+        }
+        if (line.size() > kWrap || line.find_first_not_of("01") != std::string_view::npos ||
+            (size - line.size() - 1) % (kWrap + 1) != 0) {
+            return false;
+        }
+        bitsBefore = (size - line.size() - 1) / (kWrap + 1) * kWrap + line.size();
+        if (line.size() == kWrap) {
+            keep = size;
+        } else {
+            keep = size - line.size() - 1;
+            pending.assign(line);
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::resize_file(codeFileName, keep, error);
+    return !error;
+}
+
+error_type encodeAppend(const Options& options, const std::string& inputFileName,
+                        std::ostream& out, EncodeSummary& summary, std::string& errorEntity) {
+    const OutputNames files = outputNames(inputFileName);
+    const std::string& wordTokensFileName = files.tokens;
+    const std::string& freqFileName = files.freq;
+    const std::string& hdrFileName = files.hdr;
+    const std::string& codeFileName = files.code;
+    const std::string& stateFileName = files.state;
+
+    if (error_type status; (status = regularFileExistsAndIsAvailable(inputFileName)) != NO_ERROR)
+        return fail(status, inputFileName, errorEntity);
+
+    Stats::Phase phase("state");
+    MappedFile input;
+    if (error_type status; (status = input.open(inputFileName)) != NO_ERROR)
+        return fail(status, inputFileName, errorEntity);
+    const char* data = input.data();
+    const uint64_t size = input.size();
+
+    // 1) Load the previous run: its state, counts and code. They must still
+    //    match: the input only grew, and no other run rewrote the outputs.
+    AppendState state;
+    std::map<std::string, size_t, std::less<>> counts;
+    std::vector<std::pair<std::string, std::string>> codebook;
+    bool canonicalHeader = false;
+    const char* reason = nullptr;
+    if (!readAppendState(stateFileName, state)) {
+        reason = "no previous state";
+    } else if (state.bytes > size || appendChecksum(data, state.bytes) != state.crc) {
+        reason = "input was rewritten";
+    } else {
+        std::ifstream hdrFile(hdrFileName);
+        canonicalHeader = hdrFile.peek() == '#';
+        if (fileSizeOrZero(wordTokensFileName) != state.tokensBytes ||
+            fileSizeOrZero(codeFileName) != state.codeBytes || !hdrFile.is_open() ||
+            HuffmanDecoder::readCodebook(hdrFile, codebook) != NO_ERROR ||
+            !readFrequencies(freqFileName, counts)) {
+            reason = "outputs changed since the last --append";
+        }
+    }
+
+    // If the new bytes continue the token run the old input ended in, its
+    // tokens are taken back off .tokens and the counts, and scanned again
+    const bool rescanTail = reason == nullptr && state.tailBegin < state.bytes && size > state.bytes &&
+                            charClass(data[state.bytes]) != CC_SEPARATOR;
+    uint64_t tokensKept = state.tokensBytes;
+    if (rescanTail) {
+        MappedFile tokensFile;
+        if (error_type status; (status = tokensFile.open(wordTokensFileName)) != NO_ERROR)
+            return fail(status, wordTokensFileName, errorEntity);
+        const char* tokens = tokensFile.data();
+        for (uint64_t k = 0; k < state.tailTokens && reason == nullptr; ++k) {
+            if (tokensKept == 0 || tokens[tokensKept - 1] != '\n') {
+                reason = "outputs changed since the last --append";
+                break;
+            }
+            uint64_t lineBegin = tokensKept - 1;
+            while (lineBegin > 0 && tokens[lineBegin - 1] != '\n') {
+                --lineBegin;
+            }
+            auto it = counts.find(std::string_view(tokens + lineBegin, tokensKept - 1 - lineBegin));
+            if (it == counts.end()) {
+                reason = "outputs changed since the last --append";
+            } else if (--it->second == 0) {
+                counts.erase(it);
+            }
+            tokensKept = lineBegin;
+        }
+    }
+
+    if (reason != nullptr) {
+        phase.end();
+        out << "Append: encoding the whole file (" << reason << ")\n";
+        if (error_type status; (status = encodeFile(options, inputFileName, out, summary, errorEntity)) != NO_ERROR)
+            return status;
+
+        AppendState next;
+        if (error_type status; (status = describeInput(inputFileName, data, size, next)) != NO_ERROR)
+            return fail(status, inputFileName, errorEntity);
+        next.tokensBytes = fileSizeOrZero(wordTokensFileName);
+        next.codeBytes = fileSizeOrZero(codeFileName);
+        if (error_type status; (status = writeAppendState(stateFileName, next)) != NO_ERROR)
+            return fail(status, stateFileName, errorEntity);
+        return NO_ERROR;
+    }
+
+    // 2) Scan only the new bytes, merging their counts
+    phase.next("scan");
+    const uint64_t resumeAt = rescanTail ? state.tailBegin : state.bytes;
+    std::string appended;   // new .tokens lines
+    size_t scannedTokens = 0;
+    error_type scanStatus = Scanner(std::filesystem::path(inputFileName))
+        .forEachTokenInRange(resumeAt, size, [&](std::string_view token) {
+            if (auto it = counts.find(token); it != counts.end()) {
+                ++it->second;
+            } else {
+                counts.emplace(token, 1);
+            }
+            appended.append(token).push_back('\n');
+            ++scannedTokens;
+        });
+    if (scanStatus != NO_ERROR)
+        return fail(scanStatus, inputFileName, errorEntity);
+    Stats::addBytesRead(size - resumeAt);
+
+    std::vector<std::pair<std::string, size_t>> frequencies(counts.begin(), counts.end());
+    size_t totalTokens = 0;
+    size_t totalLetters = 0;
+    for (const auto& [word, count] : frequencies) {
+        totalTokens += count;
+        totalLetters += word.size() * count;
+    }
+
+    // 3) Keep the current code unless it lacks a word, is not the kind the
+    //    options ask for, or costs more than the threshold over the code a
+    //    full run would build from the merged counts (which the current one
+    //    can also beat: the tree is not always optimal)
+    phase.next("huffman_build");
+    HuffmanTree huffman;
+    CanonicalCode canonical;
+    std::vector<std::pair<std::string, int>> limitedLengths;
+    if (error_type status; (status = buildCode(options, frequencies, hdrFileName, huffman, canonical,
+                                               limitedLengths, errorEntity)) != NO_ERROR)
+        return status;
+    std::vector<std::pair<std::string, std::string>> rebuilt;
+    getCodebook(options, huffman, canonical, rebuilt);
+
+    std::unordered_map<std::string_view, size_t> currentLengths;
+    bool sameKind = canonicalHeader == options.canonical;
+    for (const auto& [word, bits] : codebook) {
+        currentLengths.emplace(word, bits.size());
+        if (options.maxCodeLength > 0 && bits.size() > options.maxCodeLength) sameKind = false;
+    }
+    size_t rebuiltBits = 0;
+    size_t currentBits = 0;
+    bool missing = false;
+    for (const auto& [word, bits] : rebuilt) {
+        const size_t count = counts.find(word)->second;
+        rebuiltBits += count * bits.size();
+        if (auto it = currentLengths.find(word); it != currentLengths.end()) {
+            currentBits += count * it->second;
+        } else {
+            missing = true;
+        }
+    }
+    const double cost = rebuiltBits > 0 ? 100.0 * (static_cast<double>(currentBits) - rebuiltBits) / rebuiltBits : 0.0;
+    const bool regenerate = missing || !sameKind || cost > options.appendThreshold;
+
+    // 4) .tokens grows, .freq is rewritten, and .hdr only for a new code.
+    //    The state goes first, so an interrupted run is redone in full.
+    phase.next("write_tokens");
+    std::error_code removeError;
+    std::filesystem::remove(stateFileName, removeError);
+    if (rescanTail) {
+        std::error_code error;
+        std::filesystem::resize_file(wordTokensFileName, tokensKept, error);
+        if (error)
+            return fail(FAILED_TO_WRITE_FILE, wordTokensFileName, errorEntity);
+    }
+    {
+        OutputFile tokensFile;
+        if (error_type status; (status = tokensFile.open(wordTokensFileName, true)) != NO_ERROR)
+            return fail(status, wordTokensFileName, errorEntity);
+        tokensFile.stream().write(appended.data(), static_cast<std::streamsize>(appended.size()));
+        if (error_type status; (status = tokensFile.close()) != NO_ERROR)
+            return fail(status, wordTokensFileName, errorEntity);
+    }
+    Stats::addBytesWritten(appended.size());
+
+    phase.next("freq_write");
+    if (error_type status = writeFrequencies(frequencies, freqFileName, errorEntity); status != NO_ERROR)
+        return status;
+
+    if (regenerate) {
+        phase.next("header");
+        OutputFile hdrFile;
+        if (error_type status; (status = hdrFile.open(hdrFileName)) != NO_ERROR)
+            return fail(status, hdrFileName, errorEntity);
+        if (error_type status; (status = writeCodeHeader(options, huffman, canonical, hdrFile.stream())) != NO_ERROR)
+            return fail(status, hdrFileName, errorEntity);
+        if (error_type status; (status = hdrFile.close()) != NO_ERROR)
+            return fail(status, hdrFileName, errorEntity);
+        Stats::addFileWritten(hdrFileName);
+        codebook = std::move(rebuilt);
+    }
+
+    // 5) With the code unchanged, the new tokens' codes go on the end of the
+    //    existing stream. Otherwise the whole stream is encoded again, from
+    //    .tokens rather than the input.
+    phase.next("encode");
+    const TokenEncoder::Format format = options.binary ? TokenEncoder::Format::Binary
+                                                       : TokenEncoder::Format::Ascii;
+    std::string pending;
+    uint64_t bitsBefore = 0;
+    bool rewrite = regenerate || rescanTail;
+    if (!rewrite && scannedTokens > 0 && !cutCodeTail(codeFileName, format, pending, bitsBefore)) {
+        rewrite = true;
+    }
+
+    if (rewrite) {
+        MappedFile tokensFile;
+        if (error_type status; (status = tokensFile.open(wordTokensFileName)) != NO_ERROR)
+            return fail(status, wordTokensFileName, errorEntity);
+        std::vector<std::string_view> tokens;
+        tokens.reserve(totalTokens);
+        splitLines(std::string_view(tokensFile.data(), tokensFile.size()), tokens);
+
+        OutputFile codeFile;
+        if (error_type status; (status = codeFile.open(codeFileName)) != NO_ERROR)
+            return fail(status, codeFileName, errorEntity);
+        TokenEncoder encoder(codebook, codeFile.stream(), format);
+        if (error_type status; (status = encoder.encodeAll(tokens, options.threads)) != NO_ERROR)
+            return fail(status, codeFileName, errorEntity);
+        if (error_type status; (status = codeFile.close()) != NO_ERROR)
+            return fail(status, codeFileName, errorEntity);
+        Stats::addFileRead(wordTokensFileName);
+    } else if (scannedTokens > 0) {
+        OutputFile codeFile;
+        if (error_type status; (status = codeFile.open(codeFileName, true)) != NO_ERROR)
+            return fail(status, codeFileName, errorEntity);
+        TokenEncoder encoder(codebook, codeFile.stream(), format);
+        encoder.resume(pending, bitsBefore);
+        std::vector<std::string_view> tokens;
+        tokens.reserve(scannedTokens);
+        splitLines(appended, tokens);
+        for (std::string_view token : tokens) {
+            if (error_type status; (status = encoder.put(token)) != NO_ERROR)
+                return fail(status, codeFileName, errorEntity);
+        }
+        if (error_type status; (status = encoder.finish()) != NO_ERROR)
+            return fail(status, codeFileName, errorEntity);
+        if (error_type status; (status = codeFile.close()) != NO_ERROR)
+            return fail(status, codeFileName, errorEntity);
+    }
+
+    // 6) Record the new end of the input
+    phase.next("state_write");
+    AppendState next;
+    if (error_type status; (status = describeInput(inputFileName, data, size, next)) != NO_ERROR)
+        return fail(status, inputFileName, errorEntity);
+    next.tokensBytes = fileSizeOrZero(wordTokensFileName);
+    next.codeBytes = fileSizeOrZero(codeFileName);
+    if (error_type status; (status = writeAppendState(stateFileName, next)) != NO_ERROR)
+        return fail(status, stateFileName, errorEntity);
+    phase.end();
+
+    const size_t totalBits = regenerate ? rebuiltBits : currentBits;
+    out << "Appended bytes: " << size - state.bytes << '\n';
+    out << "Appended tokens: " << scannedTokens - (rescanTail ? state.tailTokens : 0) << '\n';
+    out << "Total tokens: " << totalTokens << '\n';
+    out << "Unique words: " << frequencies.size() << '\n';
+    out << "Total letters in words: " << totalLetters << '\n';
+    out << "Code: " << (regenerate ? "rebuilt" : "kept");
+    if (missing) {
+        out << " (new words)\n";
+    } else if (!sameKind) {
+        out << " (code options changed)\n";
+    } else {
+        const std::ios::fmtflags flags = out.flags();
+        out << " (threshold " << options.appendThreshold << "%, cost " << std::fixed << std::setprecision(4)
+            << std::showpos << cost << "% against a rebuilt code)\n";
+        out.flags(flags);
+        out << std::setprecision(6);
+    }
+    out << "Code stream: " << (rewrite ? "re-encoded" : scannedTokens > 0 ? "appended" : "unchanged") << '\n';
+    out << "Total encoded bits: " << totalBits << '\n';
+
+    summary.totalTokens = totalTokens;
+    summary.uniqueWords = frequencies.size();
+    summary.totalLetters = totalLetters;
+    summary.totalBits = totalBits;
+    return NO_ERROR;
+}
+
+// Inputs of a batch: named files as given, directories expanded to the
+// .txt files directly inside them, in name order
+static std::vector<std::string> expandBatchInputs(const std::vector<std::string>& names) {
+    std::vector<std::string> files;
+    for (const std::string& name : names) {
+        std::error_code error;
+        if (!std::filesystem::is_directory(name, error)) {
+            files.push_back(name);
+            continue;
+        }
+        std::vector<std::string> entries;
+        for (const auto& entry : std::filesystem::directory_iterator(name, error)) {
+            if (entry.is_regular_file(error) && entry.path().extension() == ".txt") {
+                entries.push_back(entry.path().string());
+            }
+        }
+        std::sort(entries.begin(), entries.end());
+        files.insert(files.end(), entries.begin(), entries.end());
+    }
+    return files;
+}
+
+error_type encodeBatch(const Options& options, std::ostream& out, std::ostream& err,
+                       std::string& errorEntity, bool& fatal) {
+    fatal = false;
+    const std::string dirName = std::string("input_output");
+    if (error_type status; (status = directoryExists(dirName)) != NO_ERROR) {
+        errorEntity = dirName;
+        fatal = true;
+        return status;
+    }
+
+    // With --dict every file is coded against the same dictionary, loaded once
+    SharedDictionary dictionary;
+    const bool shared = !options.dictionaryFileName.empty();
+    if (shared) {
+        if (error_type status = loadDictionary(options.dictionaryFileName, dictionary); status != NO_ERROR) {
+            errorEntity = options.dictionaryFileName;
+            fatal = true;
+            return status;
+        }
+    }
+
+    struct FileResult {
+        error_type status = NO_ERROR;
+        std::string entity;
+        EncodeSummary summary;
+    };
+    const std::vector<std::string> files = expandBatchInputs(options.inputFileNames);
+    std::vector<FileResult> results(files.size());
+
+    // Outputs are named after the input's base name, so two inputs with the
+    // same base name would overwrite each other: only the first is encoded
+    std::set<std::string> baseNames;
+    std::vector<std::pair<uintmax_t, size_t>> bySize;
+    for (size_t i = 0; i < files.size(); ++i) {
+        if (!baseNames.insert(baseNameWithoutTxt(files[i])).second) {
+            results[i].status = DUPLICATE_OUTPUT;
+            results[i].entity = files[i];
+            continue;
+        }
+        std::error_code error;
+        const uintmax_t size = std::filesystem::file_size(files[i], error);
+        bySize.emplace_back(error ? 0 : size, i);
+    }
+
+    // Smallest first: each worker starts on its largest files and the small
+    // ones are stolen by whichever worker is free (see runWorkStealing)
+    std::stable_sort(bySize.begin(), bySize.end(),
+                     [](const auto& a, const auto& b) { return a.first < b.first; });
+    std::vector<size_t> tasks;
+    for (const auto& [size, index] : bySize) {
+        tasks.push_back(index);
+    }
+
+    // Files run concurrently, so each one is encoded on a single thread,
+    // without the scan pipeline's reader and tokenizer threads
+    Options fileOptions = options;
+    fileOptions.threads = 1;
+    fileOptions.scanPipeline = false;
+    runWorkStealing(options.threads, tasks, [&](size_t i) {
+        std::ostringstream report;
+        results[i].status = shared
+            ? encodeWithDictionary(fileOptions, dictionary, files[i], report, results[i].summary, results[i].entity)
+            : encodeFile(fileOptions, files[i], report, results[i].summary, results[i].entity);
+    });
+
+    EncodeSummary total;
+    size_t failed = 0;
+    error_type firstError = NO_ERROR;
+    for (size_t i = 0; i < files.size(); ++i) {
+        const FileResult& result = results[i];
+        if (result.status != NO_ERROR) {
+            err << "Error: " << errorMessage(result.status, result.entity) << '\n';
+            out << files[i] << ": failed\n";
+            if (firstError == NO_ERROR) {
+                firstError = result.status;
+                errorEntity = result.entity;
+            }
+            ++failed;
+            continue;
+        }
+        out << files[i] << ": " << result.summary.totalTokens << " tokens, ";
+        if (!shared) {
+            out << result.summary.uniqueWords << " unique words, ";
+        }
+        out << result.summary.totalBits << " encoded bits\n";
+        total.totalTokens += result.summary.totalTokens;
+        total.totalLetters += result.summary.totalLetters;
+        total.totalBits += result.summary.totalBits;
+    }
+
+    out << "Batch files: " << files.size() << " (failed: " << failed << ")\n";
+    out << "Batch total tokens: " << total.totalTokens << '\n';
+    out << "Batch total letters in words: " << total.totalLetters << '\n';
+    out << "Batch total encoded bits: " << total.totalBits << '\n';
+    return firstError;
+}
@@ -0,0 +1,89 @@
+#ifndef PIPELINE_HPP
+#define PIPELINE_HPP
+
+#include <cstddef>
+#include <ostream>
+#include <string>
+#include <vector>
+
+#include "Options.hpp"
+#include "utils.hpp"
+#include "SharedDictionary.hpp"
+
+// Totals of one encoded file, for the batch summary
+struct EncodeSummary {
+    size_t totalTokens = 0;
+    size_t uniqueWords = 0;
+    size_t totalLetters = 0;
+    size_t totalBits = 0;
+};
+
+// Encode one input file: write input_output/<base>.tokens, .freq, .hdr and
+// .code and print the usual report to 'out'. The input_output directory
+// must exist. On failure returns the error and sets 'errorEntity' to the
+// file (or option) it concerns, for exitOnError()/errorMessage().
+error_type encodeFile(const Options& options, const std::string& inputFileName,
+                      std::ostream& out, EncodeSummary& summary, std::string& errorEntity);
+
+// --train: count the words of 'inputFileName' and write the shared
+// dictionary trained on them to options.trainFileName
+error_type trainDictionary(const Options& options, const std::string& inputFileName,
+                           std::ostream& out, std::string& errorEntity);
+
+// Read the shared dictionary in 'fileName'
+error_type loadDictionary(const std::string& fileName, SharedDictionary& dictionary);
+
+// --dict: encode 'inputFileName' in a single pass against 'dictionary',
+// writing only input_output/<base>.code (ASCII, or packed with --binary)
+error_type encodeWithDictionary(const Options& options, const SharedDictionary& dictionary,
+                                const std::string& inputFileName, std::ostream& out,
+                                EncodeSummary& summary, std::string& errorEntity);
+
+// Whether 'fileName' is a shared dictionary (as written by --train, and
+// as the .hdr of --approx)
+bool isDictionaryFile(const std::string& fileName);
+
+// --approx=K: count in bounded memory (a SpaceSaving table of K words,
+// optionally behind a Count-Min sketch), then code the words it kept and
+// escape the rest. Writes .tokens, .freq (the coded words and the escape),
+// .hdr (a shared dictionary) and .code (as --dict does).
+error_type encodeApproximate(const Options& options, const std::string& inputFileName,
+                             std::ostream& out, EncodeSummary& summary, std::string& errorEntity);
+
+// --hybrid: count exactly, then code only the words seen at least a
+// threshold number of times and escape the rest, as --dict does. The
+// threshold is the count that makes .hdr (a shared dictionary) plus .code
+// smallest, found by measuring thresholds from the lowest lower bound up.
+// Writes .tokens, .freq (as the default run), .hdr and .code.
+error_type encodeHybrid(const Options& options, const std::string& inputFileName,
+                        std::ostream& out, EncodeSummary& summary, std::string& errorEntity);
+
+// --adaptive: encode 'inputFileName' (a file, or a pipe such as /dev/stdin)
+// in one pass with adaptive Huffman codes, writing only
+// input_output/<base>.code, which grows as the input is read
+error_type encodeAdaptive(const Options& options, const std::string& inputFileName,
+                          std::ostream& out, EncodeSummary& summary, std::string& errorEntity);
+
+// --append: bring the outputs of a file that only grew since the last
+// --append run up to date. Only the new bytes are scanned; their counts are
+// merged into the previous ones from .freq and their tokens appended to
+// .tokens. The .hdr is rebuilt only when the current code lacks a word or
+// costs more than options.appendThreshold percent over the code a full run
+// would build from the merged counts; otherwise the new codes are appended
+// to the existing .code. Without a usable input_output/<base>.state, the
+// whole file is encoded as usual and the state written for the next run.
+error_type encodeAppend(const Options& options, const std::string& inputFileName,
+                        std::ostream& out, EncodeSummary& summary, std::string& errorEntity);
+
+// Batch mode: encode every file in options.inputFileNames (directories are
+// expanded to the .txt files in them) concurrently on options.threads
+// workers, each file on a single thread (against one shared dictionary
+// with options.dictionaryFileName). Prints one line per file and the
+// totals to 'out', and an error message per failed file to 'err'.
+// Returns the first error in input order (see 'errorEntity'), or NO_ERROR.
+// 'fatal' is set if no file was tried: input_output is missing or the
+// shared dictionary failed to load.
+error_type encodeBatch(const Options& options, std::ostream& out, std::ostream& err,
+                       std::string& errorEntity, bool& fatal);
+
+#endif // PIPELINE_HPP
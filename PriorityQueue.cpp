@@ -1,8 +1,9 @@
 #include "PriorityQueue.hpp"
 #include <algorithm>
-#include <fstream>
 #include <iostream>
 
+#include "OutputFile.hpp"
+
 PriorityQueue::PriorityQueue() {}
 
 bool PriorityQueue::compare(const std::pair<std::string, size_t>& a,
@@ -21,20 +22,33 @@ void PriorityQueue::buildQueue(const std::vector<std::pair<std::string, size_t>>
 }
 
 error_type PriorityQueue::writeToFile(const std::string& filename) const {
-    std::ofstream out(filename, std::ios::out | std::ios::trunc);
-    if (!out.is_open()) {
+    OutputFile file;
+    if (file.open(filename) != NO_ERROR) {
         return UNABLE_TO_OPEN_FILE_FOR_WRITING;
     }
     
+    if (write(file.stream()) != NO_ERROR || file.close() != NO_ERROR) {
+        std::cerr << "Error: failed while writing to " << filename << "\n";
+        return FAILED_TO_WRITE_FILE;
+    }
+    
+    return NO_ERROR;
+}
+
+error_type PriorityQueue::write(std::ostream& out) const {
+    // Lines are gathered into large writes, and the stream checked once
+    std::string pending;
     for (const auto& item : data_) {
-        out << item.first << " " << item.second << '\n';
-        if (!out) {
-            std::cerr << "Error: failed while writing to " << filename << "\n";
-            return FAILED_TO_WRITE_FILE;
+        pending.append(item.first).push_back(' ');
+        pending.append(std::to_string(item.second)).push_back('\n');
+        if (pending.size() >= (1 << 16)) {
+            out.write(pending.data(), pending.size());
+            pending.clear();
         }
     }
+    out.write(pending.data(), pending.size());
     
-    return NO_ERROR;
+    return out ? NO_ERROR : FAILED_TO_WRITE_FILE;
 }
 
 size_t PriorityQueue::size() const {
@@ -1,6 +1,7 @@
 #ifndef PRIORITYQUEUE_HPP
 #define PRIORITYQUEUE_HPP
 
+#include <ostream>
 #include <vector>
 #include <string>
 #include <utility>
@@ -22,6 +23,9 @@ public:
     
     // Write sorted frequencies to file
     error_type writeToFile(const std::string& filename) const;
+
+    // Write sorted frequencies ("word count" lines) to 'out'
+    error_type write(std::ostream& out) const;
     
     // Get the current size
     size_t size() const;
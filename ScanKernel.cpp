@@ -0,0 +1,175 @@
+#include "ScanKernel.hpp"
+#include <cstdlib>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define SCANKERNEL_X86 1
+#endif
+
+namespace {
+
+using ClassifyFn = void (*)(const char*, BlockMasks&);
+using LowercaseFn = void (*)(char*, const char*, size_t);
+
+// ---------------------------------------------------------------------------
+// Scalar fallback (also used for block tails)
+// ---------------------------------------------------------------------------
+
+void classifyScalar(const char* block, size_t n, BlockMasks& m) {
+    m.letters = m.upper = m.apostrophes = 0;
+    for (size_t i = 0; i < n; ++i) {
+        uint8_t cls = charClass(block[i]);
+        m.letters |= uint64_t(cls & CC_LETTER) << i;
+        m.upper |= uint64_t((cls & CC_UPPER) >> 1) << i;
+        m.apostrophes |= uint64_t((cls & CC_APOSTROPHE) >> 2) << i;
+    }
+}
+
+void classifyBlockScalar(const char* block, BlockMasks& m) {
+    classifyScalar(block, ScanKernel::kBlock, m);
+}
+
+void lowercaseScalar(char* dst, const char* src, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        char c = src[i];
+        dst[i] = (charClass(c) & CC_UPPER) ? static_cast<char>(c + ('a' - 'A')) : c;
+    }
+}
+
+#ifdef SCANKERNEL_X86
+
+// Signed-compare range checks: x is in [lo, lo+25] iff x + (128 - lo) < -128 + 26
+// when evaluated in signed 8-bit arithmetic.
+
+// ---------------------------------------------------------------------------
+// SSE2: 16 bytes per step
+// ---------------------------------------------------------------------------
+
+__attribute__((target("sse2")))
+void classifyBlockSse2(const char* block, BlockMasks& m) {
+    const __m128i fold = _mm_set1_epi8(0x20);
+    const __m128i biasLower = _mm_set1_epi8(static_cast<char>(128 - 'a'));
+    const __m128i biasUpper = _mm_set1_epi8(static_cast<char>(128 - 'A'));
+    const __m128i limit = _mm_set1_epi8(-128 + 26);
+    const __m128i apostrophe = _mm_set1_epi8('\'');
+
+    m.letters = m.upper = m.apostrophes = 0;
+    for (unsigned i = 0; i < ScanKernel::kBlock; i += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(block + i));
+        __m128i letter = _mm_cmplt_epi8(_mm_add_epi8(_mm_or_si128(v, fold), biasLower), limit);
+        __m128i upper = _mm_cmplt_epi8(_mm_add_epi8(v, biasUpper), limit);
+        __m128i apos = _mm_cmpeq_epi8(v, apostrophe);
+        m.letters |= uint64_t(static_cast<uint16_t>(_mm_movemask_epi8(letter))) << i;
+        m.upper |= uint64_t(static_cast<uint16_t>(_mm_movemask_epi8(upper))) << i;
+        m.apostrophes |= uint64_t(static_cast<uint16_t>(_mm_movemask_epi8(apos))) << i;
+    }
+}
+
+__attribute__((target("sse2")))
+void lowercaseSse2(char* dst, const char* src, size_t n) {
+    const __m128i biasUpper = _mm_set1_epi8(static_cast<char>(128 - 'A'));
+    const __m128i limit = _mm_set1_epi8(-128 + 26);
+    const __m128i fold = _mm_set1_epi8(0x20);
+
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16) {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + i));
+        __m128i upper = _mm_cmplt_epi8(_mm_add_epi8(v, biasUpper), limit);
+        v = _mm_or_si128(v, _mm_and_si128(upper, fold));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), v);
+    }
+    lowercaseScalar(dst + i, src + i, n - i);
+}
+
+// ---------------------------------------------------------------------------
+// AVX2: 32 bytes per step
+// ---------------------------------------------------------------------------
+
+__attribute__((target("avx2")))
+void classifyBlockAvx2(const char* block, BlockMasks& m) {
+    const __m256i fold = _mm256_set1_epi8(0x20);
+    const __m256i biasLower = _mm256_set1_epi8(static_cast<char>(128 - 'a'));
+    const __m256i biasUpper = _mm256_set1_epi8(static_cast<char>(128 - 'A'));
+    const __m256i limit = _mm256_set1_epi8(-128 + 26);
+    const __m256i apostrophe = _mm256_set1_epi8('\'');
+
+    m.letters = m.upper = m.apostrophes = 0;
+    for (unsigned i = 0; i < ScanKernel::kBlock; i += 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + i));
+        __m256i letter = _mm256_cmpgt_epi8(limit, _mm256_add_epi8(_mm256_or_si256(v, fold), biasLower));
+        __m256i upper = _mm256_cmpgt_epi8(limit, _mm256_add_epi8(v, biasUpper));
+        __m256i apos = _mm256_cmpeq_epi8(v, apostrophe);
+        m.letters |= uint64_t(static_cast<uint32_t>(_mm256_movemask_epi8(letter))) << i;
+        m.upper |= uint64_t(static_cast<uint32_t>(_mm256_movemask_epi8(upper))) << i;
+        m.apostrophes |= uint64_t(static_cast<uint32_t>(_mm256_movemask_epi8(apos))) << i;
+    }
+}
+
+__attribute__((target("avx2")))
+void lowercaseAvx2(char* dst, const char* src, size_t n) {
+    const __m256i biasUpper = _mm256_set1_epi8(static_cast<char>(128 - 'A'));
+    const __m256i limit = _mm256_set1_epi8(-128 + 26);
+    const __m256i fold = _mm256_set1_epi8(0x20);
+
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i));
+        __m256i upper = _mm256_cmpgt_epi8(limit, _mm256_add_epi8(v, biasUpper));
+        v = _mm256_or_si256(v, _mm256_and_si256(upper, fold));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), v);
+    }
+    lowercaseSse2(dst + i, src + i, n - i);
+}
+
+#endif // SCANKERNEL_X86
+
+struct Dispatch {
+    ClassifyFn classify;
+    LowercaseFn lowercase;
+    const char* name;
+};
+
+Dispatch selectKernel() {
+    const Dispatch scalar{classifyBlockScalar, lowercaseScalar, "scalar"};
+#ifdef SCANKERNEL_X86
+    const Dispatch sse2{classifyBlockSse2, lowercaseSse2, "sse2"};
+    const Dispatch avx2{classifyBlockAvx2, lowercaseAvx2, "avx2"};
+
+    __builtin_cpu_init();
+    const bool hasSse2 = __builtin_cpu_supports("sse2");
+    const bool hasAvx2 = hasSse2 && __builtin_cpu_supports("avx2");
+
+    if (const char* forced = std::getenv("HUFFMAN_SIMD")) {
+        if (std::strcmp(forced, "scalar") == 0) return scalar;
+        if (std::strcmp(forced, "sse2") == 0 && hasSse2) return sse2;
+        if (std::strcmp(forced, "avx2") == 0 && hasAvx2) return avx2;
+    }
+    if (hasAvx2) return avx2;
+    if (hasSse2) return sse2;
+#endif
+    return scalar;
+}
+
+const Dispatch& kernel() {
+    static const Dispatch selected = selectKernel();
+    return selected;
+}
+
+} // namespace
+
+const char* ScanKernel::name() {
+    return kernel().name;
+}
+
+void ScanKernel::classify(const char* block, BlockMasks& masks) {
+    kernel().classify(block, masks);
+}
+
+void ScanKernel::classifyTail(const char* block, size_t n, BlockMasks& masks) {
+    classifyScalar(block, n, masks);
+}
+
+void ScanKernel::lowercase(char* dst, const char* src, size_t n) {
+    kernel().lowercase(dst, src, n);
+}
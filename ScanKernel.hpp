@@ -0,0 +1,129 @@
+#ifndef SCANKERNEL_HPP
+#define SCANKERNEL_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// Character classes used by the tokenizer
+enum char_class : uint8_t {
+    CC_SEPARATOR  = 0,
+    CC_LETTER     = 1,
+    CC_UPPER      = 2,   // always set together with CC_LETTER
+    CC_APOSTROPHE = 4,
+};
+
+// 256-entry lookup table indexed by the unsigned byte value
+constexpr std::array<uint8_t, 256> makeCharClassTable() {
+    std::array<uint8_t, 256> table{};
+    for (int c = 'a'; c <= 'z'; ++c) table[c] = CC_LETTER;
+    for (int c = 'A'; c <= 'Z'; ++c) table[c] = CC_LETTER | CC_UPPER;
+    table['\''] = CC_APOSTROPHE;
+    return table;
+}
+
+inline constexpr std::array<uint8_t, 256> kCharClass = makeCharClassTable();
+
+inline uint8_t charClass(char c) {
+    return kCharClass[static_cast<unsigned char>(c)];
+}
+
+// Classification of one 64-byte block: bit i describes byte i.
+struct BlockMasks {
+    uint64_t letters;
+    uint64_t upper;
+    uint64_t apostrophes;
+};
+
+// Vectorized word scanner. The instruction set (AVX2, SSE2 or the scalar
+// table) is chosen once at startup; the environment variable HUFFMAN_SIMD
+// (avx2 / sse2 / scalar) overrides the choice for testing.
+class ScanKernel {
+public:
+    static constexpr size_t kBlock = 64;
+
+    // Name of the selected implementation
+    static const char* name();
+
+    // Classify a full 64-byte block
+    static void classify(const char* block, BlockMasks& masks);
+
+    // Classify the first n (< 64) bytes of a block; missing bytes are separators
+    static void classifyTail(const char* block, size_t n, BlockMasks& masks);
+
+    // Copy n bytes from src to dst, lowercasing A-Z
+    static void lowercase(char* dst, const char* src, size_t n);
+
+    // Scan data[0, size) and call emit(begin, end, hasUpper) for every token,
+    // in order. Tokens follow the Scanner rules: runs of letters with
+    // apostrophes kept only between two letters.
+    template <typename Emit>
+    static void forEachWord(const char* data, size_t size, Emit&& emit);
+
+private:
+    static uint64_t rangeMask(unsigned first, unsigned last) {
+        return (~0ULL << first) & (~0ULL >> (63 - last));
+    }
+};
+
+template <typename Emit>
+void ScanKernel::forEachWord(const char* data, size_t size, Emit&& emit) {
+    bool prevLetter = false;   // letter bit of the byte before the block
+    bool open = false;         // a token runs into the current block
+    bool upper = false;
+    size_t start = 0;
+
+    for (size_t base = 0; base < size; base += kBlock) {
+        const size_t n = size - base < kBlock ? size - base : kBlock;
+        BlockMasks m;
+        if (n == kBlock) {
+            classify(data + base, m);
+        } else {
+            classifyTail(data + base, n, m);
+        }
+
+        const bool nextLetter = base + kBlock < size && (charClass(data[base + kBlock]) & CC_LETTER);
+        const uint64_t before = (m.letters << 1) | uint64_t(prevLetter);
+        const uint64_t after = (m.letters >> 1) | (uint64_t(nextLetter) << 63);
+        const uint64_t token = m.letters | (m.apostrophes & before & after);
+
+        uint64_t starts = token & ~((token << 1) | uint64_t(open));
+        // Last byte of each token; bit 63 is resolved by the next block
+        uint64_t ends = token & ~(token >> 1) & ~(1ULL << 63);
+
+        if (open && !(token & 1)) {
+            emit(start, base, upper);
+            open = false;
+        }
+
+        unsigned segStart = 0;
+        while (true) {
+            if (!open) {
+                if (starts == 0) break;
+                segStart = static_cast<unsigned>(__builtin_ctzll(starts));
+                starts &= starts - 1;
+                start = base + segStart;
+                upper = false;
+                open = true;
+            }
+            if (ends == 0) {
+                // The token continues into the next block
+                upper |= (m.upper & rangeMask(segStart, 63)) != 0;
+                break;
+            }
+            unsigned last = static_cast<unsigned>(__builtin_ctzll(ends));
+            ends &= ends - 1;
+            upper |= (m.upper & rangeMask(segStart, last)) != 0;
+            emit(start, base + last + 1, upper);
+            open = false;
+        }
+
+        prevLetter = (m.letters >> 63) & 1;
+    }
+
+    if (open) {
+        emit(start, size, upper);
+    }
+}
+
+#endif // SCANKERNEL_HPP
@@ -5,28 +5,55 @@
 #include "Scanner.hpp"
 #include <utility>
 #include <iostream>
-#include <fstream>
+#include <thread>
+#include <fcntl.h>
 #include "utils.hpp"
+#include "ScanKernel.hpp"
+#include "Threads.hpp"
 
 Scanner::Scanner(std::filesystem::path inputPath) 
     : inputPath_(std::move(inputPath)) {
 }
 
 error_type Scanner::tokenize(std::vector<std::string>& words) {
-    std::ifstream inFile(inputPath_);
-    if (!inFile.is_open()) {
-        return UNABLE_TO_OPEN_FILE;
+    std::vector<std::string_view> views;
+    if (error_type status = tokenize(views); status != NO_ERROR) {
+        return status;
     }
-    
-    std::string word;
-    while (!(word = readWord(inFile)).empty()) {
-        words.push_back(word);
+
+    words.reserve(words.size() + views.size());
+    for (std::string_view view : views) {
+        words.emplace_back(view);
     }
-    
-    inFile.close();
     return NO_ERROR;
 }
 
+error_type Scanner::tokenize(std::vector<std::string_view>& words) {
+    if (error_type status = input_.open(inputPath_); status != NO_ERROR) {
+        return status;
+    }
+    lowerArena_.reset();
+    lowerArenaSize_ = 0;
+    lowerArenaUsed_ = 0;
+
+    const char* data = input_.data();
+    const size_t size = input_.size();
+
+    ScanKernel::forEachWord(data, size, [&](size_t begin, size_t end, bool hasUpper) {
+        if (hasUpper) {
+            words.push_back(lowercaseIntoArena(data, size, begin, end));
+        } else {
+            words.emplace_back(data + begin, end - begin);
+        }
+    });
+
+    return NO_ERROR;
+}
+
+error_type Scanner::tokenize(TokenInterner& interner, std::vector<uint32_t>& ids) {
+    return forEachToken([&](std::string_view token) { ids.push_back(interner.intern(token)); });
+}
+
 error_type Scanner::tokenize(std::vector<std::string>& words,
                             const std::filesystem::path& outputFile) {
     // First, tokenize into memory using the other overload
@@ -39,52 +66,155 @@ error_type Scanner::tokenize(std::vector<std::string>& words,
     return writeVectorToFile(outputFile.string(), words);
 }
 
-std::string Scanner::readWord(std::istream& in) {
-    std::string word;
-    char c;
-    
-    // Skip everything until we find a letter (a-z or A-Z)
-    while (in.get(c)) {
-        if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z')) {
-            // Convert to lowercase and start the word
-            if (c >= 'A' && c <= 'Z') {
-                word += (c - 'A' + 'a');
-            } else {
-                word += c;
-            }
-            break;
-        }
+std::string_view Scanner::lowercaseIntoArena(const char* data, size_t size,
+                                             size_t begin, size_t end) {
+    // Every later token lies inside data[begin, size), so one allocation of
+    // that many bytes is enough for the rest of the input.
+    if (!lowerArena_) {
+        lowerArenaSize_ = size - begin;
+        lowerArena_ = std::make_unique<char[]>(lowerArenaSize_);
+        lowerArenaUsed_ = 0;
     }
-    
-    // If no letter was found, we've reached end of input
-    if (word.empty()) {
-        return "";
+
+    char* out = lowerArena_.get() + lowerArenaUsed_;
+    ScanKernel::lowercase(out, data + begin, end - begin);
+    lowerArenaUsed_ += end - begin;
+    return std::string_view(out, end - begin);
+}
+
+error_type Scanner::forEachBatch(const std::function<void(std::string_view text,
+                                                         const std::vector<size_t>& ends)>& consume) {
+    // Two more threads per task would oversubscribe a work-stealing pool
+    // (--batch turns the pipeline off for its files)
+    if (onWorkStealingWorker()) {
+        return NESTED_THREADS;
     }
-    
-    // Continue building the word with letters and internal apostrophes
-    while (in.get(c)) {
-        if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z')) {
-            // Letter - add it (converting to lowercase if needed)
-            if (c >= 'A' && c <= 'Z') {
-                word += (c - 'A' + 'a');
-            } else {
-                word += c;
+
+    const int fd = ::open(inputPath_.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return UNABLE_TO_OPEN_FILE;
+    }
+
+    struct Chunk {
+        std::vector<char> bytes;
+        size_t size = 0;
+        bool last = false;
+        error_type status = NO_ERROR;
+    };
+    struct Batch {
+        std::string text;
+        std::vector<size_t> ends;
+        bool last = false;
+        error_type status = NO_ERROR;
+    };
+
+    // Chunks and batches go round: free -> filled -> consumed -> free
+    std::vector<Chunk> chunks(kPipelineDepth);
+    std::vector<Batch> batches(kPipelineDepth);
+    SpscQueue<uint32_t> freeChunks(kPipelineDepth), fullChunks(kPipelineDepth);
+    SpscQueue<uint32_t> freeBatches(kPipelineDepth), fullBatches(kPipelineDepth);
+    for (uint32_t i = 0; i < kPipelineDepth; ++i) {
+        chunks[i].bytes.resize(kPipelineChunk);
+        freeChunks.push(i);
+        freeBatches.push(i);
+    }
+
+    // Reader: fill a chunk, cut it after its last separator, and carry the
+    // unfinished token over to the front of the next chunk
+    std::thread reader([&] {
+        uint32_t current = freeChunks.pop();
+        size_t held = 0;
+        for (;;) {
+            Chunk& chunk = chunks[current];
+            if (held == chunk.bytes.size()) {
+                chunk.bytes.resize(chunk.bytes.size() * 2);   // one token fills the chunk
+            }
+            const ssize_t count = ::read(fd, chunk.bytes.data() + held, chunk.bytes.size() - held);
+            if (count < 0 && errno == EINTR) continue;
+            if (count <= 0) {
+                chunk.size = held;
+                chunk.last = true;
+                chunk.status = count < 0 ? FAILED_TO_READ_FILE : NO_ERROR;
+                fullChunks.push(current);
+                return;
+            }
+
+            const size_t size = held + static_cast<size_t>(count);
+            size_t end = size;
+            while (end > 0 && charClass(chunk.bytes[end - 1]) != CC_SEPARATOR) {
+                --end;
+            }
+            if (size < chunk.bytes.size() || end == 0) {
+                held = size;   // read more before cutting
+                continue;
             }
-        } else if (c == '\'') {
-            // Apostrophe - only include if followed by a letter (internal apostrophe)
-            char next = in.peek();
-            if ((next >= 'a' && next <= 'z') || (next >= 'A' && next <= 'Z')) {
-                // It's internal (followed by a letter) - include it
-                word += '\'';
-            } else {
-                // Not followed by a letter - end the word
-                break;
+
+            const uint32_t next = freeChunks.pop();
+            Chunk& nextChunk = chunks[next];
+            held = size - end;
+            if (nextChunk.bytes.size() < std::max(held, kPipelineChunk)) {
+                nextChunk.bytes.resize(std::max(held * 2, kPipelineChunk));
             }
+            std::memcpy(nextChunk.bytes.data(), chunk.bytes.data() + end, held);
+            chunk.size = end;
+            chunk.last = false;
+            chunk.status = NO_ERROR;
+            fullChunks.push(current);
+            current = next;
+        }
+    });
+
+    // Tokenizer: one batch per chunk
+    std::thread tokenizer([&] {
+        for (;;) {
+            const uint32_t chunkIndex = fullChunks.pop();
+            const uint32_t batchIndex = freeBatches.pop();
+            const Chunk& chunk = chunks[chunkIndex];
+            Batch& batch = batches[batchIndex];
+            const char* window = chunk.bytes.data();
+
+            // Every token but the last is followed by a separator in the
+            // chunk, so the text needs at most one byte more than the chunk
+            batch.text.resize(chunk.size + 1);
+            batch.ends.clear();
+            char* out = batch.text.data();
+            size_t used = 0;
+            ScanKernel::forEachWord(window, chunk.size, [&](size_t first, size_t last, bool hasUpper) {
+                if (hasUpper) {
+                    ScanKernel::lowercase(out + used, window + first, last - first);
+                } else {
+                    std::memcpy(out + used, window + first, last - first);
+                }
+                used += last - first;
+                batch.ends.push_back(used);
+                out[used++] = '\n';
+            });
+            batch.text.resize(used);
+            const bool last = chunk.last;
+            batch.last = last;
+            batch.status = chunk.status;
+            freeChunks.push(chunkIndex);
+            fullBatches.push(batchIndex);
+            if (last) return;
+        }
+    });
+
+    // Consumer: this thread
+    error_type status = NO_ERROR;
+    for (bool last = false; !last;) {
+        const uint32_t batchIndex = fullBatches.pop();
+        const Batch& batch = batches[batchIndex];
+        if (batch.status != NO_ERROR) {
+            status = batch.status;
         } else {
-            // Any other character is a separator - end the word
-            break;
+            consume(batch.text, batch.ends);
         }
+        last = batch.last;
+        freeBatches.push(batchIndex);
     }
-    
-    return word;
-}
\ No newline at end of file
+
+    reader.join();
+    tokenizer.join();
+    ::close(fd);
+    return status;
+}
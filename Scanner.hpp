@@ -4,33 +4,185 @@
 
 #ifndef IMPLEMENTATION_FILETOWORDS_HPP
 #define IMPLEMENTATION_FILETOWORDS_HPP
+#include <algorithm>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <functional>
 #include <string>
+#include <string_view>
+#include <utility>
 #include <vector>
+#include <memory>
 #include <filesystem>
+#include <unistd.h>
 
 #include "utils.hpp"
+#include "MappedFile.hpp"
+#include "ScanKernel.hpp"
+#include "TokenInterner.hpp"
 
 class Scanner {
 public:
     explicit Scanner(std::filesystem::path inputPath);
 
     // Tokenize into memory (according to the Rules in this section).
+    // Thin adapter over the zero-copy overload below.
     error_type tokenize(std::vector<std::string>& words);
 
+    // Zero-copy tokenize: maps the input file and appends one view per token.
+    // Token boundaries come from the vectorized ScanKernel and follow the project’s
+    // tokenization rules: letters a–z with optional internal apostrophes;
+    // digits, punctuation, hyphens/dashes, whitespace, and non‑ASCII are separators.
+    // Tokens that are already lowercase point straight into the mapping; the
+    // rest are lowercased into a single arena owned by the Scanner. The views
+    // stay valid until the Scanner is destroyed or tokenize() is called again.
+    error_type tokenize(std::vector<std::string_view>& words);
+
+    // Tokenize straight into token IDs: each token is interned as it is
+    // scanned and only its ID is kept (4 bytes per token).
+    error_type tokenize(TokenInterner& interner, std::vector<uint32_t>& ids);
+
     // Tokenize and also write one token per line to 'outputFile' (e.g., <base>.tokens).
     // This overload should internally call the in‑memory tokenize() to avoid duplicate logic.
     error_type tokenize(std::vector<std::string>& words,
                         const std::filesystem::path& outputFile);
 
+    // Streaming tokenize: calls callback(token) for each token in order and
+    // keeps neither the tokens nor the scanned part of the file in memory.
+    // The view passed to the callback is only valid during the call.
+    template <typename Callback>
+    error_type forEachToken(Callback&& callback);
+
+    // Same, over bytes [rangeBegin, rangeEnd) of the file only (rangeEnd is
+    // clamped to its size). rangeBegin must not fall inside a token: 0, or
+    // just after a separator byte.
+    template <typename Callback>
+    error_type forEachTokenInRange(uint64_t rangeBegin, uint64_t rangeEnd, Callback&& callback);
+
+    // Tokenize whatever can be read from 'fd' (a file, pipe or socket) as it
+    // arrives, without mapping it: callback(token) for each token completed
+    // by a read, then afterRead() once per read, until end of input. Only
+    // an unfinished run of token bytes is held back between reads.
+    template <typename Callback, typename AfterRead>
+    static error_type forEachTokenRead(int fd, Callback&& callback, AfterRead&& afterRead);
+
+    // Pipelined tokenize: a reader thread reads the file in chunks that end
+    // on a separator, a tokenizer thread turns each chunk into a batch, and
+    // the calling thread gets consume(text, ends) for each batch, in order,
+    // while the next chunks are read and tokenized. 'text' holds the
+    // batch's tokens lowercased, each followed by '\n' (the .tokens
+    // layout); token i ends at ends[i]. The stages are joined by bounded
+    // SpscQueues, so at most kPipelineDepth chunks and batches exist at once.
+    // Returns NESTED_THREADS, starting no thread, on a runWorkStealing()
+    // worker.
+    error_type forEachBatch(const std::function<void(std::string_view text,
+                                                     const std::vector<size_t>& ends)>& consume);
+
     ~Scanner() = default;
 
 private:
-    // Read the next token from 'in'. Returns empty string when no more tokens.
-    // Follows the project’s tokenization rules: letters a–z with optional internal apostrophes;
-    // digits, punctuation, hyphens/dashes, whitespace, and non‑ASCII are separators.
-    static std::string readWord(std::istream& in);
+    // Bytes scanned by forEachToken() before their pages are released
+    static constexpr size_t kStreamWindow = size_t(16) << 20;
+
+    // Bytes asked for per read() by forEachTokenRead()
+    static constexpr size_t kReadChunk = size_t(1) << 16;
+
+    // forEachBatch(): bytes per chunk, and chunks (and batches) in flight
+    static constexpr size_t kPipelineChunk = size_t(1) << 20;
+    static constexpr size_t kPipelineDepth = 4;
+
+    // callback(token) for each token of window[0, size); tokens with
+    // uppercase letters are lowercased into 'lower'
+    template <typename Callback>
+    static void emitTokens(const char* window, size_t size, std::string& lower, Callback& callback);
+
+
+    // Copy data[begin, end) lowercased into the arena and return a view of the copy
+    std::string_view lowercaseIntoArena(const char* data, size_t size, size_t begin, size_t end);
 
     std::filesystem::path inputPath_;
+    MappedFile input_;
+
+    // Lowercased copies of tokens that contain uppercase letters. Allocated once,
+    // sized to the remaining input, so it never moves while views point into it.
+    std::unique_ptr<char[]> lowerArena_;
+    size_t lowerArenaSize_ = 0;
+    size_t lowerArenaUsed_ = 0;
 };
 
+template <typename Callback>
+error_type Scanner::forEachToken(Callback&& callback) {
+    return forEachTokenInRange(0, UINT64_MAX, std::forward<Callback>(callback));
+}
+
+template <typename Callback>
+error_type Scanner::forEachTokenInRange(uint64_t rangeBegin, uint64_t rangeEnd, Callback&& callback) {
+    MappedFile input;
+    if (error_type status = input.open(inputPath_); status != NO_ERROR) {
+        return status;
+    }
+
+    const char* data = input.data();
+    const size_t size = static_cast<size_t>(std::min<uint64_t>(rangeEnd, input.size()));
+    std::string lower;
+
+    // Windows end on a separator byte, so no token spans two of them
+    size_t begin = static_cast<size_t>(std::min<uint64_t>(rangeBegin, size));
+    while (begin < size) {
+        size_t end = size - begin > kStreamWindow ? begin + kStreamWindow : size;
+        while (end < size && charClass(data[end]) != CC_SEPARATOR) {
+            ++end;
+        }
+
+        emitTokens(data + begin, end - begin, lower, callback);
+        input.release(end);
+        begin = end;
+    }
+    return NO_ERROR;
+}
+
+template <typename Callback, typename AfterRead>
+error_type Scanner::forEachTokenRead(int fd, Callback&& callback, AfterRead&& afterRead) {
+    std::vector<char> buffer(kReadChunk);
+    std::string lower;
+    size_t held = 0;   // unfinished token bytes at the front of 'buffer'
+    for (;;) {
+        if (held == buffer.size()) {
+            buffer.resize(buffer.size() * 2);
+        }
+        const ssize_t count = ::read(fd, buffer.data() + held, buffer.size() - held);
+        if (count < 0) {
+            if (errno == EINTR) continue;
+            return FAILED_TO_READ_FILE;
+        }
+
+        // At the end of input the last token is complete too; otherwise the
+        // tokens up to the last separator are
+        const size_t size = held + static_cast<size_t>(count);
+        size_t end = size;
+        while (count > 0 && end > 0 && charClass(buffer[end - 1]) != CC_SEPARATOR) {
+            --end;
+        }
+        emitTokens(buffer.data(), end, lower, callback);
+        std::memmove(buffer.data(), buffer.data() + end, size - end);
+        held = size - end;
+        afterRead();
+        if (count == 0) return NO_ERROR;
+    }
+}
+
+template <typename Callback>
+void Scanner::emitTokens(const char* window, size_t size, std::string& lower, Callback& callback) {
+    ScanKernel::forEachWord(window, size, [&](size_t first, size_t last, bool hasUpper) {
+        if (hasUpper) {
+            lower.resize(last - first);
+            ScanKernel::lowercase(lower.data(), window + first, last - first);
+            callback(std::string_view(lower));
+        } else {
+            callback(std::string_view(window + first, last - first));
+        }
+    });
+}
+
 #endif //IMPLEMENTATION_FILETOWORDS_HPP
\ No newline at end of file
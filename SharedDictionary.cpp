@@ -0,0 +1,230 @@
+#include "SharedDictionary.hpp"
+#include "MappedFile.hpp"
+#include "PackageMerge.hpp"
+
+#include <algorithm>
+#include <sstream>
+#include <unordered_map>
+
+SharedDictionary::SharedDictionary() : escapeId_(0), endId_(0) {
+    charIds_.fill(PerfectHash::kNotFound);
+}
+
+error_type SharedDictionary::train(const std::vector<std::pair<std::string, size_t>>& frequencies) {
+    std::vector<std::pair<std::string, size_t>> kept;
+    std::array<size_t, 256> charCounts{};
+    size_t escapeCount = 0;
+    for (const auto& [word, count] : frequencies) {
+        if (count >= kMinCount) {
+            kept.emplace_back(word, count);
+            continue;
+        }
+        escapeCount += count;
+        for (unsigned char c : word) {
+            charCounts[c] += count;
+        }
+    }
+    return build(std::move(kept), escapeCount, charCounts);
+}
+
+error_type SharedDictionary::build(std::vector<std::pair<std::string, size_t>> words, size_t escapeCount,
+                                   const std::array<size_t, 256>& charCounts) {
+    if (error_type status = buildCodes(std::move(words), escapeCount, charCounts); status != NO_ERROR) {
+        return status;
+    }
+    return buildLookups();
+}
+
+error_type SharedDictionary::measure(const std::vector<std::pair<std::string, size_t>>& words, size_t escapeCount,
+                                     const std::array<size_t, 256>& charCounts, uint64_t& headerBytes,
+                                     uint64_t& codeBits) {
+    SharedDictionary dictionary;
+    if (error_type status = dictionary.buildCodes(words, escapeCount, charCounts); status != NO_ERROR) {
+        return status;
+    }
+    std::ostringstream header;
+    if (error_type status = dictionary.write(header); status != NO_ERROR) {
+        return status;
+    }
+    headerBytes = header.str().size();
+
+    // The escape's code is used 'escapeCount' times, not the count it was
+    // built with; so is the end symbol's
+    std::unordered_map<std::string_view, size_t> counts;
+    counts.reserve(words.size() + 1);
+    for (const auto& [word, count] : words) {
+        counts.emplace(word, count);
+    }
+    counts[kEscape] = escapeCount;
+    codeBits = 0;
+    for (size_t i = 0; i < dictionary.words_.size(); ++i) {
+        codeBits += uint64_t(counts[dictionary.words_.wordAt(i)]) * dictionary.words_.codeLengthAt(i);
+    }
+    for (size_t i = 0; i < dictionary.characters_.size(); ++i) {
+        const std::string_view symbol = dictionary.characters_.wordAt(i);
+        const size_t count = symbol == kEnd ? escapeCount : charCounts[static_cast<unsigned char>(symbol[0])];
+        codeBits += uint64_t(count) * dictionary.characters_.codeLengthAt(i);
+    }
+    return NO_ERROR;
+}
+
+// The word and character codes of build(), without the lookups
+error_type SharedDictionary::buildCodes(std::vector<std::pair<std::string, size_t>> words, size_t escapeCount,
+                                        const std::array<size_t, 256>& charCounts) {
+    std::vector<std::pair<std::string, size_t>> kept = std::move(words);
+    kept.emplace_back(std::string(kEscape), codedEscapeCount(escapeCount));
+
+    // Every escaped word ends with kEnd
+    std::vector<std::pair<std::string, size_t>> characters;
+    characters.emplace_back(std::string(kEnd), escapeCount + 1);
+    characters.emplace_back("'", charCounts['\''] + 1);
+    for (char c = 'a'; c <= 'z'; ++c) {
+        characters.emplace_back(std::string(1, c), charCounts[static_cast<unsigned char>(c)] + 1);
+    }
+
+    std::vector<std::pair<std::string, int>> lengths;
+    if (error_type status = packageMergeLengths(kept, kMaxCodeLength, lengths); status != NO_ERROR) {
+        return status;
+    }
+    if (error_type status = words_.build(std::move(lengths)); status != NO_ERROR) {
+        return status;
+    }
+    lengths.clear();
+    if (error_type status = packageMergeLengths(characters, kMaxCodeLength, lengths); status != NO_ERROR) {
+        return status;
+    }
+    return characters_.build(std::move(lengths));
+}
+
+error_type SharedDictionary::write(std::ostream& os) const {
+    if (!os.good()) {
+        return UNABLE_TO_OPEN_FILE_FOR_WRITING;
+    }
+    os << "#dictionary 1\n";
+    if (error_type status = words_.writeHeader(os); status != NO_ERROR) {
+        return status;
+    }
+    return characters_.writeHeader(os);
+}
+
+error_type SharedDictionary::read(std::istream& is) {
+    std::string line;
+    if (!std::getline(is, line) || line != "#dictionary 1") {
+        return INVALID_HEADER;
+    }
+    if (error_type status = words_.readHeader(is); status != NO_ERROR) {
+        return status;
+    }
+    is >> std::ws;   // the word code's last line break
+    if (error_type status = characters_.readHeader(is); status != NO_ERROR) {
+        return status;
+    }
+    return buildLookups();
+}
+
+// Perfect hash, symbol IDs and decode tables for the two codes
+error_type SharedDictionary::buildLookups() {
+    const uint32_t wordSymbols = static_cast<uint32_t>(words_.size());
+    std::vector<std::string_view> words;
+    words.reserve(wordSymbols);
+    bool hasEscape = false;
+    for (uint32_t i = 0; i < wordSymbols; ++i) {
+        words.push_back(words_.wordAt(i));
+        if (words.back() == kEscape) {
+            escapeId_ = i;
+            hasEscape = true;
+        }
+    }
+    if (!hasEscape) return INVALID_HEADER;
+    if (error_type status = lookup_.build(words); status != NO_ERROR) {
+        return status;
+    }
+
+    // Every character a token can hold, and the end symbol, must have a code
+    charIds_.fill(PerfectHash::kNotFound);
+    endId_ = PerfectHash::kNotFound;
+    for (uint32_t i = 0; i < characters_.size(); ++i) {
+        const std::string_view symbol = characters_.wordAt(i);
+        if (symbol == kEnd) {
+            endId_ = wordSymbols + i;
+        } else if (symbol.size() == 1) {
+            charIds_[static_cast<unsigned char>(symbol[0])] = wordSymbols + i;
+        } else {
+            return INVALID_HEADER;
+        }
+    }
+    if (endId_ == PerfectHash::kNotFound || charIds_['\''] == PerfectHash::kNotFound ||
+        std::any_of(charIds_.begin() + 'a', charIds_.begin() + 'z' + 1,
+                    [](uint32_t id) { return id == PerfectHash::kNotFound; })) {
+        return INVALID_HEADER;
+    }
+
+    codes_.clear();
+    for (const CanonicalCode* code : {&words_, &characters_}) {
+        for (size_t i = 0; i < code->size(); ++i) {
+            codes_.emplace_back(code->codeAt(i), code->codeLengthAt(i));
+        }
+    }
+
+    // The decoders load the same canonical headers
+    std::stringstream wordHeader, characterHeader;
+    words_.writeHeader(wordHeader);
+    characters_.writeHeader(characterHeader);
+    if (error_type status = wordDecoder_.readHeader(wordHeader); status != NO_ERROR) {
+        return status;
+    }
+    return characterDecoder_.readHeader(characterHeader);
+}
+
+error_type SharedDictionary::decodeFile(const std::string& codeFileName, std::vector<std::string_view>& tokens) {
+    MappedFile file;
+    if (error_type status = file.open(codeFileName); status != NO_ERROR) {
+        return status;
+    }
+    std::vector<unsigned char> packed;
+    const unsigned char* bits = nullptr;
+    size_t bytes = 0;
+    uint64_t bitCount = 0;
+    if (error_type status = HuffmanDecoder::unpackCode(reinterpret_cast<const unsigned char*>(file.data()),
+                                                       file.size(), packed, bits, bytes, bitCount);
+        status != NO_ERROR) {
+        return status;
+    }
+    if (bitCount > uint64_t(bytes) * 8) return INVALID_CODE;
+
+    // Escaped words are spelled into the arena; their views are filled in at
+    // the end, once the arena has stopped growing
+    spelled_.clear();
+    std::vector<std::pair<size_t, std::pair<size_t, size_t>>> escaped;   // token, (offset, length)
+    const uint32_t endSymbol = endId_ - static_cast<uint32_t>(words_.size());
+    std::string word;
+    uint64_t pos = 0;
+    while (pos < bitCount) {
+        uint32_t symbol;
+        if (error_type status = wordDecoder_.decodeSymbol(bits, bytes, pos, symbol); status != NO_ERROR) {
+            return status;
+        }
+        if (symbol != escapeId_) {
+            tokens.push_back(wordDecoder_.symbol(symbol));
+            continue;
+        }
+
+        word.clear();
+        for (;;) {
+            if (pos >= bitCount) return INVALID_CODE;
+            if (error_type status = characterDecoder_.decodeSymbol(bits, bytes, pos, symbol); status != NO_ERROR) {
+                return status;
+            }
+            if (symbol == endSymbol) break;
+            word += characterDecoder_.symbol(symbol);
+        }
+        escaped.emplace_back(tokens.size(), std::make_pair(spelled_.add(word), word.size()));
+        tokens.emplace_back();
+    }
+    for (const auto& [token, location] : escaped) {
+        tokens[token] = spelled_.view(location.first, location.second);
+    }
+
+    // The last code must end exactly at the last real bit
+    return pos == bitCount ? NO_ERROR : INVALID_CODE;
+}
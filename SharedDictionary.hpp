@@ -0,0 +1,117 @@
+#ifndef SHAREDDICTIONARY_HPP
+#define SHAREDDICTIONARY_HPP
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "utils.hpp"
+#include "CanonicalCode.hpp"
+#include "HuffmanDecoder.hpp"
+#include "PerfectHash.hpp"
+#include "StringArena.hpp"
+
+// A codebook trained once from a corpus (--train) and shared by every file
+// encoded against it (--dict). Files then need no counting pass and no .hdr.
+//
+// Two canonical codes:
+//   words       - every training word seen at least kMinCount times, plus
+//                 kEscape, which stands for any other word
+//   characters  - the apostrophe, 'a'..'z' and kEnd, for spelling out the
+//                 words that are escaped
+// An out-of-vocabulary word is coded as kEscape, its characters, then kEnd.
+// The escape and character counts are learned from the training words seen
+// fewer than kMinCount times, as the best guess at what unseen words look
+// like. Every character also gets one extra count, so any word can be spelled.
+//
+// Dictionary file (text): "#dictionary 1", then the word code and the
+// character code, each as a canonical header (see CanonicalCode.hpp).
+class SharedDictionary {
+public:
+    static constexpr std::string_view kEscape = "#esc";
+    static constexpr std::string_view kEnd = "#end";
+    static constexpr size_t kMinCount = 2;
+    // Codes are length-limited, so any vocabulary fits the encoder's 64-bit codes
+    static constexpr int kMaxCodeLength = 32;
+
+    SharedDictionary();
+
+    // Build both codes from (word, count) pairs
+    error_type train(const std::vector<std::pair<std::string, size_t>>& frequencies);
+
+    // Build both codes from the words to keep, with their counts, plus the
+    // number of tokens to escape and the counts of their characters (by byte)
+    error_type build(std::vector<std::pair<std::string, size_t>> words, size_t escapeCount,
+                     const std::array<size_t, 256>& charCounts);
+
+    // The count kEscape is coded with for 'escapeCount' escaped tokens: at
+    // least 1, so that it always has a code
+    static size_t codedEscapeCount(size_t escapeCount) { return std::max<size_t>(escapeCount, 1); }
+
+    // The .hdr bytes and .code bits of the dictionary build() makes from the
+    // same arguments, when it codes those words and escaped tokens. Builds
+    // only the two codes, not the lookups, so it is much cheaper than build().
+    static error_type measure(const std::vector<std::pair<std::string, size_t>>& words, size_t escapeCount,
+                              const std::array<size_t, 256>& charCounts, uint64_t& headerBytes,
+                              uint64_t& codeBits);
+
+    error_type write(std::ostream& os) const;
+    error_type read(std::istream& is);
+
+    // Number of dictionary words (not counting kEscape)
+    size_t size() const { return words_.size() - 1; }
+
+    // (code, length) of every symbol, for TokenEncoder: the word code's
+    // symbols in order, then the character code's. The IDs passed to
+    // putToken's callback index this list.
+    const std::vector<std::pair<uint64_t, int>>& codes() const { return codes_; }
+
+    // Call put(id) for each symbol of 'token' (a Scanner token): its word ID,
+    // or the escape sequence. Returns false if the token was escaped.
+    template <typename Put>
+    bool putToken(std::string_view token, Put&& put) const;
+
+    // Decode a binary or ASCII .code file written with this dictionary.
+    // The views point into this object and stay valid until the next decode.
+    error_type decodeFile(const std::string& codeFileName, std::vector<std::string_view>& tokens);
+
+private:
+    error_type buildCodes(std::vector<std::pair<std::string, size_t>> words, size_t escapeCount,
+                          const std::array<size_t, 256>& charCounts);
+    error_type buildLookups();
+
+    CanonicalCode words_;
+    CanonicalCode characters_;
+    PerfectHash lookup_;                   // word -> index in words_
+    uint32_t escapeId_;
+    uint32_t endId_;
+    std::array<uint32_t, 256> charIds_;    // byte -> symbol ID, or PerfectHash::kNotFound
+    std::vector<std::pair<uint64_t, int>> codes_;
+
+    HuffmanDecoder wordDecoder_;
+    HuffmanDecoder characterDecoder_;
+    StringArena spelled_;                  // escaped words of the last decode
+};
+
+template <typename Put>
+bool SharedDictionary::putToken(std::string_view token, Put&& put) const {
+    if (const uint32_t id = lookup_.find(token); id != PerfectHash::kNotFound) {
+        put(id);
+        return true;
+    }
+    put(escapeId_);
+    for (unsigned char c : token) {
+        put(charIds_[c]);
+    }
+    put(endId_);
+    return false;
+}
+
+#endif // SHAREDDICTIONARY_HPP
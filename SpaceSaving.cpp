@@ -0,0 +1,108 @@
+#include "SpaceSaving.hpp"
+#include "HashCounter.hpp"
+
+#include <utility>
+
+SpaceSaving::SpaceSaving(size_t capacity, CountMinSketch* sketch)
+    : capacity_(capacity), sketch_(sketch) {
+    size_t slots = 16;
+    while (slots < 2 * capacity) slots *= 2;
+    slots_.assign(slots, kEmpty);
+    mask_ = slots - 1;
+    entries_.reserve(capacity);
+    hashes_.reserve(capacity);
+    slotOf_.reserve(capacity);
+}
+
+void SpaceSaving::add(std::string_view word) {
+    const uint64_t hash = HashCounter::hashWord(word);
+    const uint64_t estimate = sketch_ ? sketch_->add(hash) : 0;
+
+    size_t slot = findSlot(word, hash);
+    if (slots_[slot] != kEmpty) {
+        const size_t entry = slots_[slot] - 1;
+        ++entries_[entry].count;
+        siftDown(entry);
+        return;
+    }
+
+    if (entries_.size() < capacity_) {
+        const uint64_t count = sketch_ ? estimate : 1;
+        entries_.push_back(Entry{std::string(word), count, count - 1});
+        hashes_.push_back(hash);
+        slotOf_.push_back(slot);
+        slots_[slot] = static_cast<uint32_t>(entries_.size());
+        siftUp(entries_.size() - 1);
+        return;
+    }
+
+    // Replace the smallest count (the heap's root)
+    const uint64_t minimum = entries_[0].count;
+    if (sketch_ && estimate <= minimum) return;
+    eraseSlot(slotOf_[0]);
+    slot = findSlot(word, hash);   // the erase may have shifted slots
+    entries_[0].word.assign(word);
+    entries_[0].count = sketch_ ? estimate : minimum + 1;
+    entries_[0].error = entries_[0].count - 1;   // the word may be new
+    hashes_[0] = hash;
+    slotOf_[0] = slot;
+    slots_[slot] = 1;
+    siftDown(0);
+}
+
+// The slot holding 'word', or the empty slot where it would go
+size_t SpaceSaving::findSlot(std::string_view word, uint64_t hash) const {
+    size_t slot = hash & mask_;
+    while (slots_[slot] != kEmpty) {
+        const size_t entry = slots_[slot] - 1;
+        if (hashes_[entry] == hash && entries_[entry].word == word) break;
+        slot = (slot + 1) & mask_;
+    }
+    return slot;
+}
+
+// Empty 'slot', then move back every later entry of the probe run whose
+// home slot is not between the hole and itself, so lookups never stop early
+void SpaceSaving::eraseSlot(size_t slot) {
+    slots_[slot] = kEmpty;
+    size_t hole = slot;
+    for (size_t next = (hole + 1) & mask_; slots_[next] != kEmpty; next = (next + 1) & mask_) {
+        const size_t entry = slots_[next] - 1;
+        const size_t home = hashes_[entry] & mask_;
+        if (((next - home) & mask_) >= ((next - hole) & mask_)) {
+            slots_[hole] = slots_[next];
+            slotOf_[entry] = hole;
+            slots_[next] = kEmpty;
+            hole = next;
+        }
+    }
+}
+
+void SpaceSaving::swapEntries(size_t a, size_t b) {
+    std::swap(entries_[a], entries_[b]);
+    std::swap(hashes_[a], hashes_[b]);
+    std::swap(slotOf_[a], slotOf_[b]);
+    slots_[slotOf_[a]] = static_cast<uint32_t>(a + 1);
+    slots_[slotOf_[b]] = static_cast<uint32_t>(b + 1);
+}
+
+void SpaceSaving::siftUp(size_t entry) {
+    while (entry > 0) {
+        const size_t parent = (entry - 1) / 2;
+        if (entries_[parent].count <= entries_[entry].count) break;
+        swapEntries(parent, entry);
+        entry = parent;
+    }
+}
+
+void SpaceSaving::siftDown(size_t entry) {
+    for (;;) {
+        size_t smallest = entry;
+        for (size_t child = 2 * entry + 1; child <= 2 * entry + 2 && child < entries_.size(); ++child) {
+            if (entries_[child].count < entries_[smallest].count) smallest = child;
+        }
+        if (smallest == entry) return;
+        swapEntries(entry, smallest);
+        entry = smallest;
+    }
+}
@@ -0,0 +1,66 @@
+#ifndef SPACESAVING_HPP
+#define SPACESAVING_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "CountMinSketch.hpp"
+
+// Heavy hitters in bounded memory (SpaceSaving, Metwally et al.). At most
+// 'capacity' words are tracked, each with a count and the most by which
+// that count may overstate the true one. A tracked word's count goes up by
+// one. An untracked word takes the place of the tracked word with the
+// smallest count m, starting at m + 1 with error m. After N words, every
+// word seen more than N / capacity times is tracked, and no count is below
+// the true one.
+//
+// With a CountMinSketch, an untracked word only takes a place once the
+// sketch estimates its count above m, and starts at that estimate, with
+// error one less (the sketch may overstate it). Words seen once, which are
+// most of a large vocabulary, then no longer push out the words being
+// tracked. Counts are still never below the true ones, but a word the
+// sketch keeps out may be missed: the N / capacity guarantee holds only
+// without a sketch.
+//
+// Entries sit in a min-heap on count, found through an open-addressing
+// table of entry indices (linear probing, backward-shift deletion).
+class SpaceSaving {
+public:
+    struct Entry {
+        std::string word;
+        uint64_t count;
+        uint64_t error;   // count - error is a lower bound on the true count
+    };
+
+    // 'sketch' (optional) must outlive this object
+    explicit SpaceSaving(size_t capacity, CountMinSketch* sketch = nullptr);
+
+    void add(std::string_view word);
+
+    size_t size() const { return entries_.size(); }
+
+    // Tracked words, in no particular order
+    const std::vector<Entry>& entries() const { return entries_; }
+
+private:
+    static constexpr uint32_t kEmpty = 0;   // slots_ holds entry index + 1
+
+    size_t findSlot(std::string_view word, uint64_t hash) const;
+    void eraseSlot(size_t slot);
+    void swapEntries(size_t a, size_t b);
+    void siftUp(size_t entry);
+    void siftDown(size_t entry);
+
+    size_t capacity_;
+    CountMinSketch* sketch_;
+    std::vector<Entry> entries_;     // min-heap on count
+    std::vector<uint64_t> hashes_;   // per entry
+    std::vector<size_t> slotOf_;     // per entry: its slot
+    std::vector<uint32_t> slots_;
+    size_t mask_;
+};
+
+#endif // SPACESAVING_HPP
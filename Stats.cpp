@@ -0,0 +1,214 @@
+#include "Stats.hpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <iomanip>
+#include <mutex>
+#include <sstream>
+#include <new>
+#include <vector>
+#include <sys/resource.h>
+
+namespace {
+
+struct PhaseRecord {
+    const char* name;
+    size_t count;
+    double seconds;
+    uint64_t allocations;
+    uint64_t allocatedBytes;
+};
+
+std::atomic<uint64_t> allocationCount{0};
+std::atomic<uint64_t> allocationBytes{0};
+
+// The same, for the calling thread only: what a phase counts, so that
+// phases running at once on other threads (--batch) do not add to it
+thread_local uint64_t threadAllocationCount = 0;
+thread_local uint64_t threadAllocationBytes = 0;
+std::atomic<uint64_t> bytesRead{0};
+std::atomic<uint64_t> bytesWritten{0};
+
+std::mutex phaseMutex;
+
+std::vector<PhaseRecord>& phaseRecords() {
+    static std::vector<PhaseRecord> records;
+    return records;
+}
+
+// 'text' as a JSON string literal
+void writeJsonString(std::ostream& os, const std::string& text) {
+    os << '"';
+    for (unsigned char c : text) {
+        if (c == '"' || c == '\\') {
+            os << '\\' << c;
+        } else if (c < 0x20) {
+            os << "\\u" << std::hex << std::setw(4) << std::setfill('0') << static_cast<int>(c)
+               << std::dec << std::setfill(' ');
+        } else {
+            os << c;
+        }
+    }
+    os << '"';
+}
+
+} // namespace
+
+// Global allocation functions: count while stats are enabled, otherwise
+// behave exactly like the default ones. new[], nothrow and sized forms all
+// route through these two.
+void* operator new(std::size_t size) {
+    if (Stats::enabled()) {
+        allocationCount.fetch_add(1, std::memory_order_relaxed);
+        allocationBytes.fetch_add(size, std::memory_order_relaxed);
+        ++threadAllocationCount;
+        threadAllocationBytes += size;
+    }
+    if (size == 0) {
+        size = 1;
+    }
+    while (true) {
+        if (void* block = std::malloc(size)) {
+            return block;
+        }
+        std::new_handler handler = std::get_new_handler();
+        if (handler == nullptr) {
+            throw std::bad_alloc();
+        }
+        handler();
+    }
+}
+
+void operator delete(void* block) noexcept {
+    std::free(block);
+}
+
+void operator delete(void* block, std::size_t) noexcept {
+    std::free(block);
+}
+
+bool Stats::enabled_ = false;
+
+void Stats::enable() {
+    enabled_ = true;
+}
+
+void Stats::addBytesRead(uint64_t bytes) {
+    bytesRead.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+void Stats::addBytesWritten(uint64_t bytes) {
+    bytesWritten.fetch_add(bytes, std::memory_order_relaxed);
+}
+
+void Stats::addFileRead(const std::string& filename) {
+    if (!enabled_) return;
+    std::error_code error;
+    const auto size = std::filesystem::file_size(filename, error);
+    if (!error) addBytesRead(size);
+}
+
+void Stats::addFileWritten(const std::string& filename) {
+    if (!enabled_) return;
+    std::error_code error;
+    const auto size = std::filesystem::file_size(filename, error);
+    if (!error) addBytesWritten(size);
+}
+
+uint64_t Stats::allocations() {
+    return allocationCount.load(std::memory_order_relaxed);
+}
+
+uint64_t Stats::allocatedBytes() {
+    return allocationBytes.load(std::memory_order_relaxed);
+}
+
+uint64_t Stats::threadAllocations() {
+    return threadAllocationCount;
+}
+
+uint64_t Stats::threadAllocatedBytes() {
+    return threadAllocationBytes;
+}
+
+uint64_t Stats::peakRssBytes() {
+    struct rusage usage;
+    if (getrusage(RUSAGE_SELF, &usage) != 0) {
+        return 0;
+    }
+    return static_cast<uint64_t>(usage.ru_maxrss) * 1024;   // ru_maxrss is in KiB on Linux
+}
+
+// Phases of the same name add up (--batch runs every phase once per file,
+// on several threads at once)
+void Stats::recordPhase(const char* name, double seconds, uint64_t allocations, uint64_t allocatedBytes) {
+    std::lock_guard<std::mutex> lock(phaseMutex);
+    for (PhaseRecord& record : phaseRecords()) {
+        if (std::strcmp(record.name, name) == 0) {
+            ++record.count;
+            record.seconds += seconds;
+            record.allocations += allocations;
+            record.allocatedBytes += allocatedBytes;
+            return;
+        }
+    }
+    phaseRecords().push_back({name, 1, seconds, allocations, allocatedBytes});
+}
+
+void Stats::writeJson(std::ostream& out, const std::string& inputFileName) {
+    // Formatted here, so the caller's stream keeps its flags and precision
+    std::ostringstream os;
+    std::lock_guard<std::mutex> lock(phaseMutex);
+    double totalSeconds = 0.0;
+    os << "{\"input\":";
+    writeJsonString(os, inputFileName);
+    os << ",\"phases\":[";
+    const std::vector<PhaseRecord>& records = phaseRecords();
+    for (size_t i = 0; i < records.size(); ++i) {
+        const PhaseRecord& record = records[i];
+        totalSeconds += record.seconds;
+        os << (i > 0 ? "," : "") << "{\"name\":\"" << record.name << "\""
+           << ",\"count\":" << record.count
+           << ",\"seconds\":" << std::fixed << std::setprecision(6) << record.seconds
+           << ",\"allocations\":" << record.allocations
+           << ",\"allocated_bytes\":" << record.allocatedBytes << '}';
+    }
+    os << "],\"totals\":{\"seconds\":" << totalSeconds
+       << ",\"allocations\":" << allocations()
+       << ",\"allocated_bytes\":" << allocatedBytes()
+       << ",\"bytes_read\":" << bytesRead.load()
+       << ",\"bytes_written\":" << bytesWritten.load()
+       << ",\"peak_rss_bytes\":" << peakRssBytes() << "}}\n";
+    out << os.str();
+}
+
+Stats::Phase::Phase(const char* name) {
+    begin(name);
+}
+
+Stats::Phase::~Phase() {
+    end();
+}
+
+void Stats::Phase::next(const char* name) {
+    end();
+    begin(name);
+}
+
+void Stats::Phase::begin(const char* name) {
+    if (!enabled_) return;
+    name_ = name;
+    allocations_ = threadAllocations();
+    allocatedBytes_ = threadAllocatedBytes();
+    start_ = std::chrono::steady_clock::now();
+}
+
+void Stats::Phase::end() {
+    if (name_ == nullptr) return;
+    const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start_;
+    recordPhase(name_, elapsed.count(), threadAllocations() - allocations_,
+                threadAllocatedBytes() - allocatedBytes_);
+    name_ = nullptr;
+}
@@ -0,0 +1,76 @@
+#ifndef STATS_HPP
+#define STATS_HPP
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+
+// Per-phase instrumentation behind --stats=json: wall time and heap
+// allocations of each phase, bytes read and written, and peak RSS.
+//
+// Off unless enable() is called. Then a phase does a single branch and
+// never reads the clock, and the global operator new only tests one flag.
+class Stats {
+public:
+    // Start collecting. Call before any worker thread starts.
+    static void enable();
+    static bool enabled() { return enabled_; }
+
+    // Bytes consumed from input files / produced in output files
+    static void addBytesRead(uint64_t bytes);
+    static void addBytesWritten(uint64_t bytes);
+
+    // Add the current size of 'filename' to the bytes read / written
+    static void addFileRead(const std::string& filename);
+    static void addFileWritten(const std::string& filename);
+
+    // Heap allocations so far (counted only while enabled)
+    static uint64_t allocations();
+    static uint64_t allocatedBytes();
+
+    // Heap allocations so far by the calling thread
+    static uint64_t threadAllocations();
+    static uint64_t threadAllocatedBytes();
+
+    // Peak resident set size of the process, in bytes (0 if unknown)
+    static uint64_t peakRssBytes();
+
+    // Write everything collected as one JSON object and a newline
+    static void writeJson(std::ostream& os, const std::string& inputFileName);
+
+    // Timer for the numbered phases of main(): times one phase at a time,
+    // from construction or next() until the following next() or destruction.
+    // A phase counts the allocations of its own thread; those of the threads
+    // it starts (--threads, the scan pipeline) are only in the totals.
+    class Phase {
+    public:
+        explicit Phase(const char* name);
+        ~Phase();
+
+        Phase(const Phase&) = delete;
+        Phase& operator=(const Phase&) = delete;
+
+        // End the current phase and start 'name'
+        void next(const char* name);
+
+        // End the current phase (no-op if already ended)
+        void end();
+
+    private:
+        void begin(const char* name);
+
+        const char* name_ = nullptr;
+        std::chrono::steady_clock::time_point start_;
+        uint64_t allocations_ = 0;
+        uint64_t allocatedBytes_ = 0;
+    };
+
+private:
+    static void recordPhase(const char* name, double seconds, uint64_t allocations, uint64_t allocatedBytes);
+
+    static bool enabled_;
+};
+
+#endif // STATS_HPP
@@ -0,0 +1,7 @@
+#include "StringArena.hpp"
+
+size_t StringArena::add(std::string_view text) {
+    const size_t offset = data_.size();
+    data_.insert(data_.end(), text.begin(), text.end());
+    return offset;
+}
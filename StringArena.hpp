@@ -0,0 +1,31 @@
+#ifndef STRINGARENA_HPP
+#define STRINGARENA_HPP
+
+#include <cstddef>
+#include <string_view>
+#include <vector>
+
+// Append-only storage for many short strings in one contiguous buffer.
+// Strings are addressed by (offset, length); offsets stay valid when the
+// buffer grows, unlike pointers or string_views.
+class StringArena {
+public:
+    // Copy 'text' to the end of the arena and return its offset
+    size_t add(std::string_view text);
+
+    // View of the string stored at 'offset' (invalidated by the next add())
+    std::string_view view(size_t offset, size_t length) const {
+        return std::string_view(data_.data() + offset, length);
+    }
+
+    // Total bytes stored
+    size_t size() const { return data_.size(); }
+
+    void reserve(size_t bytes) { data_.reserve(bytes); }
+    void clear() { data_.clear(); }
+
+private:
+    std::vector<char> data_;
+};
+
+#endif // STRINGARENA_HPP
@@ -0,0 +1,143 @@
+#ifndef THREADS_HPP
+#define THREADS_HPP
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Run body(i) for i in [0, n) on n threads
+template <typename Body>
+void runOnThreads(size_t n, Body body) {
+    std::vector<std::thread> workers;
+    workers.reserve(n);
+    for (size_t i = 0; i < n; ++i) {
+        workers.emplace_back(body, i);
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+// Whether the calling thread is a worker of runWorkStealing(), whose pool
+// already runs one task per thread
+inline bool& onWorkStealingWorker() {
+    static thread_local bool worker = false;
+    return worker;
+}
+
+// Run body(task) for every task in 'tasks' on 'threads' workers, with
+// work stealing. Tasks are dealt round-robin, in the given order, onto one
+// deque per worker. A worker takes its own tasks from the back; once its
+// deque is empty it steals from the front of the others'. Pass the tasks
+// smallest first: each worker then starts on its largest tasks while idle
+// workers steal the small ones, so short tasks never wait behind a long one.
+template <typename Body>
+void runWorkStealing(size_t threads, const std::vector<size_t>& tasks, Body body) {
+    struct WorkerQueue {
+        std::mutex mutex;
+        std::deque<size_t> tasks;
+    };
+    threads = std::max<size_t>(1, std::min(threads, tasks.size()));
+    std::vector<std::unique_ptr<WorkerQueue>> queues;
+    for (size_t i = 0; i < threads; ++i) {
+        queues.push_back(std::make_unique<WorkerQueue>());
+    }
+    for (size_t i = 0; i < tasks.size(); ++i) {
+        queues[i % threads]->tasks.push_back(tasks[i]);
+    }
+
+    runOnThreads(threads, [&](size_t self) {
+        onWorkStealingWorker() = true;
+        while (true) {
+            size_t task = 0;
+            bool found = false;
+            {
+                std::lock_guard<std::mutex> lock(queues[self]->mutex);
+                if (!queues[self]->tasks.empty()) {
+                    task = queues[self]->tasks.back();
+                    queues[self]->tasks.pop_back();
+                    found = true;
+                }
+            }
+            for (size_t k = 1; !found && k < threads; ++k) {
+                WorkerQueue& victim = *queues[(self + k) % threads];
+                std::lock_guard<std::mutex> lock(victim.mutex);
+                if (!victim.tasks.empty()) {
+                    task = victim.tasks.front();
+                    victim.tasks.pop_front();
+                    found = true;
+                }
+            }
+            // No task is ever added, so an empty sweep means all are taken
+            if (!found) {
+                return;
+            }
+            body(task);
+        }
+    });
+}
+
+// Bounded single-producer, single-consumer queue (a lock-free ring). One
+// thread pushes and one thread pops; push() waits while the queue is full,
+// which is the backpressure between pipeline stages, and pop() waits while
+// it is empty. A wait yields a few times, then sleeps in short steps, so a
+// stage that waits for a slower one does not take its CPU time.
+template <typename T>
+class SpscQueue {
+public:
+    // Room for at least 'capacity' values
+    explicit SpscQueue(size_t capacity) : head_(0), tail_(0) {
+        size_t slots = 1;
+        while (slots < capacity) slots *= 2;
+        slots_.resize(slots);
+        mask_ = slots - 1;
+    }
+
+    bool tryPush(const T& value) {
+        const size_t tail = tail_.load(std::memory_order_relaxed);
+        if (tail - head_.load(std::memory_order_acquire) > mask_) return false;
+        slots_[tail & mask_] = value;
+        tail_.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    bool tryPop(T& value) {
+        const size_t head = head_.load(std::memory_order_relaxed);
+        if (head == tail_.load(std::memory_order_acquire)) return false;
+        value = slots_[head & mask_];
+        head_.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    void push(const T& value) {
+        for (unsigned tries = 0; !tryPush(value); ++tries) backOff(tries);
+    }
+
+    T pop() {
+        T value;
+        for (unsigned tries = 0; !tryPop(value); ++tries) backOff(tries);
+        return value;
+    }
+
+private:
+    static void backOff(unsigned tries) {
+        if (tries < 16) {
+            std::this_thread::yield();
+        } else {
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+        }
+    }
+
+    std::vector<T> slots_;
+    size_t mask_;
+    alignas(64) std::atomic<size_t> head_;   // next slot to pop; written by the consumer
+    alignas(64) std::atomic<size_t> tail_;   // next slot to push; written by the producer
+};
+
+#endif // THREADS_HPP
@@ -0,0 +1,431 @@
+#include "TokenEncoder.hpp"
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <iostream>
+#include "Threads.hpp"
+
+TokenEncoder::TokenEncoder(const std::vector<std::pair<std::string, std::string>>& codebook,
+                           std::ostream& os, Format format, int wrap_cols,
+                           uint64_t tokensPerBlock, uint64_t bytesPerBlock)
+    : os_(os), format_(format), wrapCols_(wrap_cols), tokens_(0), totalBits_(0),
+      tokensPerBlock_(tokensPerBlock), bytesPerBlock_(bytesPerBlock), blockTokens_(0), blockStartBits_(0),
+      bytesWritten_(0) {
+    words_.reserve(codebook.size());
+    codes_.reserve(codebook.size());
+    lookup_.reserve(codebook.size());
+    for (const auto& [word, code] : codebook) {
+        codes_.push_back(PackedCode{chunks_.size(), code.size()});
+        for (size_t i = 0; i < code.size(); i += 64) {
+            uint64_t chunk = 0;
+            for (size_t j = i; j < std::min(code.size(), i + 64); ++j) {
+                chunk = (chunk << 1) | (code[j] == '1');
+            }
+            chunks_.push_back(chunk);
+        }
+        words_.push_back(word);
+    }
+    // words_ no longer grows, so views of its strings stay valid
+    for (size_t i = 0; i < words_.size(); ++i) {
+        lookup_.emplace(words_[i], static_cast<uint32_t>(i));
+    }
+
+    setUpOutput();
+}
+
+TokenEncoder::TokenEncoder(const std::vector<std::pair<uint64_t, int>>& codes,
+                           std::ostream& os, Format format, int wrap_cols,
+                           uint64_t tokensPerBlock, uint64_t bytesPerBlock)
+    : os_(os), format_(format), wrapCols_(wrap_cols), tokens_(0), totalBits_(0),
+      tokensPerBlock_(tokensPerBlock), bytesPerBlock_(bytesPerBlock), blockTokens_(0), blockStartBits_(0),
+      bytesWritten_(0) {
+    codes_.reserve(codes.size());
+    chunks_.reserve(codes.size());
+    for (const auto& [code, length] : codes) {
+        codes_.push_back(PackedCode{chunks_.size(), static_cast<size_t>(length)});
+        chunks_.push_back(code);
+    }
+    setUpOutput();
+}
+
+void TokenEncoder::setUpOutput() {
+    if (format_ == Format::Binary) {
+        bits_ = std::make_unique<BitWriter>(os_);
+    } else if (format_ == Format::Blocks) {
+        bits_ = std::make_unique<BitWriter>(blockStream_);
+        index_.tokensPerBlock = tokensPerBlock_;
+    } else {
+        line_.reserve(wrapCols_ + 1);
+    }
+}
+
+error_type TokenEncoder::put(std::string_view token) {
+    auto it = lookup_.find(token);
+    if (it == lookup_.end()) {
+        std::cerr << "Error: Token '" << token << "' not found in codebook\n";
+        return FAILED_TO_WRITE_FILE;
+    }
+    return putId(it->second);
+}
+
+error_type TokenEncoder::putId(uint32_t id) {
+    const PackedCode& code = codes_[id];
+    ++tokens_;
+    totalBits_ += code.length;
+    if (format_ == Format::Ascii) {
+        putAscii(code);
+        return NO_ERROR;
+    }
+
+    putBits(code);
+    if (format_ != Format::Blocks) {
+        return NO_ERROR;
+    }
+    ++blockTokens_;
+    return blockFull() ? endBlock() : NO_ERROR;
+}
+
+void TokenEncoder::putBits(const PackedCode& code) {
+    const uint64_t* chunk = &chunks_[code.firstChunk];
+    size_t remaining = code.length;
+    for (; remaining > 64; remaining -= 64) {
+        bits_->write(*chunk++, 64);
+    }
+    bits_->write(*chunk, static_cast<int>(remaining));
+}
+
+error_type TokenEncoder::endBlock() {
+    if (error_type status = bits_->flush(); status != NO_ERROR) {
+        return status;
+    }
+
+    const std::string bytes = blockStream_.str();
+    blockStream_.str("");
+    const auto* data = reinterpret_cast<const unsigned char*>(bytes.data());
+    index_.blocks.push_back(BlockEntry{bytesWritten_ * 8, totalBits_ - blockStartBits_,
+                                       tokens_ - blockTokens_, static_cast<uint32_t>(blockTokens_),
+                                       BlockIndex::crc32(data, bytes.size())});
+    os_.write(bytes.data(), bytes.size());
+    bytesWritten_ += bytes.size();
+    blockStartBits_ = totalBits_;
+    blockTokens_ = 0;
+
+    if (!os_) return FAILED_TO_WRITE_FILE;
+    return NO_ERROR;
+}
+
+void TokenEncoder::putAscii(const PackedCode& code) {
+    for (size_t i = 0; i < code.length; ++i) {
+        putAsciiBit(bitAt(code, i));
+    }
+}
+
+void TokenEncoder::putAsciiBit(bool bit) {
+    line_ += bit ? '1' : '0';
+
+    if (static_cast<int>(line_.size()) >= wrapCols_) {
+        line_ += '\n';
+        os_.write(line_.data(), line_.size());
+        line_.clear();
+    }
+}
+
+void TokenEncoder::putCode(uint64_t code, int length) {
+    totalBits_ += length;
+    if (format_ == Format::Ascii) {
+        for (int i = length - 1; i >= 0; --i) {
+            putAsciiBit((code >> i) & 1);
+        }
+        return;
+    }
+    bits_->write(code, length);
+}
+
+error_type TokenEncoder::flush() {
+    if (format_ == Format::Binary) {
+        bits_->flushWholeBytes();
+    }
+    os_.flush();
+    if (!os_) return FAILED_TO_WRITE_FILE;
+    return NO_ERROR;
+}
+
+void TokenEncoder::resume(std::string_view pending, uint64_t bitsBefore) {
+    totalBits_ = bitsBefore;
+    if (format_ == Format::Ascii) {
+        line_.assign(pending);
+        return;
+    }
+
+    uint64_t bits = 0;
+    for (char bit : pending) {
+        bits = (bits << 1) | (bit == '1');
+    }
+    bits_->addPrecedingBits(bitsBefore - pending.size());
+    bits_->write(bits, static_cast<int>(pending.size()));
+}
+
+error_type TokenEncoder::finish() {
+    if (format_ == Format::Binary) {
+        return bits_->finish();
+    }
+    if (format_ == Format::Blocks) {
+        if (blockTokens_ > 0) {
+            if (error_type status = endBlock(); status != NO_ERROR) {
+                return status;
+            }
+        }
+        return index_.write(os_);
+    }
+
+    if (!os_.good()) {
+        return UNABLE_TO_OPEN_FILE_FOR_WRITING;
+    }
+
+    // Same ending as HuffmanTree::encode: a lone newline for no tokens,
+    // otherwise a newline after a partial last line
+    if ((tokens_ == 0 && totalBits_ == 0) || !line_.empty()) {
+        line_ += '\n';
+        os_.write(line_.data(), line_.size());
+        line_.clear();
+    }
+
+    if (!os_) return FAILED_TO_WRITE_FILE;
+    return NO_ERROR;
+}
+
+// Pack the codes of ids[0, count) into 'out' from bit 'startBit' on. With
+// sharedEdges, a first or last byte that this range only partly fills goes
+// to edges[0] / edges[1] instead, because a neighbouring range writes the
+// rest of it; the caller ORs them in.
+void TokenEncoder::packRange(const uint32_t* ids, size_t count, uint64_t startBit,
+                             unsigned char* out, bool sharedEdges, unsigned char edges[2]) const {
+    size_t byte = static_cast<size_t>(startBit / 8);
+    int used = static_cast<int>(startBit % 8);   // leading bits belong to the range before
+    bool firstShared = sharedEdges && used != 0;
+    uint64_t acc = 0;
+
+    auto storeWord = [&]() {
+        if (firstShared) {
+            edges[0] = static_cast<unsigned char>(acc >> 56);
+            for (int k = 1; k < 8; ++k) {
+                out[byte + k] = static_cast<unsigned char>(acc >> (56 - 8 * k));
+            }
+            firstShared = false;
+        } else {
+            uint64_t bigEndian = acc;
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+            bigEndian = __builtin_bswap64(bigEndian);
+#endif
+            std::memcpy(out + byte, &bigEndian, 8);
+        }
+        byte += 8;
+    };
+
+    auto write = [&](uint64_t code, int length) {
+        if (length < 64) code &= (1ULL << length) - 1;
+        const int free = 64 - used;
+        if (length < free) {
+            acc |= code << (free - length);
+            used += length;
+            return;
+        }
+        const int rest = length - free;
+        acc |= code >> rest;
+        storeWord();
+        acc = rest ? code << (64 - rest) : 0;
+        used = rest;
+    };
+
+    for (size_t t = 0; t < count; ++t) {
+        const PackedCode& code = codes_[ids[t]];
+        const uint64_t* chunk = &chunks_[code.firstChunk];
+        size_t remaining = code.length;
+        for (; remaining > 64; remaining -= 64) {
+            write(*chunk++, 64);
+        }
+        if (remaining > 0) write(*chunk, static_cast<int>(remaining));
+    }
+
+    // Whole bytes left in the accumulator, then a partial last byte
+    const int fullBytes = used / 8;
+    for (int k = 0; k < fullBytes; ++k) {
+        const auto b = static_cast<unsigned char>(acc >> (56 - 8 * k));
+        if (k == 0 && firstShared) {
+            edges[0] = b;
+            firstShared = false;
+        } else {
+            out[byte + k] = b;
+        }
+    }
+    if (used % 8 != 0) {
+        const auto b = static_cast<unsigned char>(acc >> (56 - 8 * fullBytes));
+        if (fullBytes == 0 && firstShared) {
+            edges[0] = b;   // the range starts and ends inside this byte
+        } else if (sharedEdges) {
+            edges[1] = b;
+        } else {
+            out[byte + fullBytes] = b;
+        }
+    }
+}
+
+// Write the ASCII form of ids[0, count) into 'out', starting at code bit
+// 'startBit'. Bit i sits at character i + i / wrapCols_, so slices never
+// share a character.
+void TokenEncoder::writeAsciiRange(const uint32_t* ids, size_t count, uint64_t startBit, char* out) const {
+    const uint64_t wrap = static_cast<uint64_t>(wrapCols_);
+    uint64_t bit = startBit;
+    char* pos = out + bit + bit / wrap;
+    uint64_t column = bit % wrap;
+    for (size_t t = 0; t < count; ++t) {
+        const PackedCode& code = codes_[ids[t]];
+        for (size_t i = 0; i < code.length; ++i) {
+            *pos++ = bitAt(code, i) ? '1' : '0';
+            if (++column == wrap) {
+                *pos++ = '\n';
+                column = 0;
+            }
+        }
+    }
+}
+
+error_type TokenEncoder::encodeAll(const std::vector<std::string_view>& tokens, unsigned threads) {
+    // Codebook index of every token, looked up in parallel slices
+    const size_t n = tokens.size();
+    const size_t workers = std::max<size_t>(1, std::min<size_t>(threads, n / 4096));
+    std::vector<uint32_t> ids(n);
+    std::vector<size_t> missing(workers, n);
+    runOnThreads(workers, [&](size_t w) {
+        for (size_t i = n * w / workers; i < n * (w + 1) / workers; ++i) {
+            auto it = lookup_.find(tokens[i]);
+            if (it == lookup_.end()) {
+                missing[w] = i;
+                return;
+            }
+            ids[i] = it->second;
+        }
+    });
+    for (size_t w = 0; w < workers; ++w) {
+        if (missing[w] != n) {
+            std::cerr << "Error: Token '" << tokens[missing[w]] << "' not found in codebook\n";
+            return FAILED_TO_WRITE_FILE;
+        }
+    }
+    return encodeIds(ids, threads);
+}
+
+error_type TokenEncoder::encodeIds(const std::vector<uint32_t>& ids, unsigned threads) {
+    if (!os_.good()) {
+        return UNABLE_TO_OPEN_FILE_FOR_WRITING;
+    }
+
+    // Work is split into units of consecutive tokens: one per block for the
+    // container (blocks are byte aligned, so they share nothing), otherwise
+    // one per thread. Small inputs are not worth extra threads.
+    const size_t n = ids.size();
+    const size_t workers = std::max<size_t>(1, std::min<size_t>(threads, n / 4096));
+    std::vector<size_t> unitBegin;   // first token of every unit, then n
+    if (format_ == Format::Blocks && bytesPerBlock_ > 0) {
+        // Byte-bounded blocks are cut where putId() would cut them, which
+        // takes one serial walk over the code lengths
+        uint64_t bits = 0;
+        uint64_t count = 0;
+        unitBegin.push_back(0);
+        for (size_t i = 0; i < n; ++i) {
+            bits += codes_[ids[i]].length;
+            if (++count == tokensPerBlock_ || bits >= bytesPerBlock_ * 8) {
+                unitBegin.push_back(i + 1);
+                bits = 0;
+                count = 0;
+            }
+        }
+        if (unitBegin.back() != n) unitBegin.push_back(n);
+    } else {
+        const size_t perUnit = format_ == Format::Blocks ? static_cast<size_t>(tokensPerBlock_)
+                                                         : std::max<size_t>(1, (n + workers - 1) / workers);
+        for (size_t u = 0; u * perUnit < n; ++u) {
+            unitBegin.push_back(u * perUnit);
+        }
+        unitBegin.push_back(n);
+    }
+    const size_t units = unitBegin.size() - 1;
+    auto unitsOf = [&](size_t w) { return std::make_pair(units * w / workers, units * (w + 1) / workers); };
+    auto tokensOf = [&](size_t u) { return std::make_pair(unitBegin[u], unitBegin[u + 1]); };
+
+    // 1) Bits of every unit
+    std::vector<uint64_t> unitBits(units + 1, 0);
+    runOnThreads(workers, [&](size_t w) {
+        auto [firstUnit, lastUnit] = unitsOf(w);
+        for (size_t u = firstUnit; u < lastUnit; ++u) {
+            auto [begin, end] = tokensOf(u);
+            uint64_t bits = 0;
+            for (size_t i = begin; i < end; ++i) {
+                bits += codes_[ids[i]].length;
+            }
+            unitBits[u + 1] = bits;
+        }
+    });
+
+    // 2) Exclusive prefix sum: where each unit starts. Container blocks each
+    //    start on a byte boundary.
+    std::vector<uint64_t> unitStart(units + 1, 0);
+    for (size_t u = 0; u < units; ++u) {
+        const uint64_t span = format_ == Format::Blocks ? (unitBits[u + 1] + 7) / 8 * 8 : unitBits[u + 1];
+        unitStart[u + 1] = unitStart[u] + span;
+    }
+    const uint64_t endBit = unitStart[units];
+    tokens_ = n;
+    for (size_t u = 0; u < units; ++u) {
+        totalBits_ += unitBits[u + 1];
+    }
+
+    // 3) Every thread writes its units into the shared buffer
+    if (format_ == Format::Ascii) {
+        const uint64_t wrap = static_cast<uint64_t>(wrapCols_);
+        std::string text(static_cast<size_t>(endBit + (endBit + wrap - 1) / wrap), '\n');
+        runOnThreads(workers, [&](size_t w) {
+            auto [firstUnit, lastUnit] = unitsOf(w);
+            for (size_t u = firstUnit; u < lastUnit; ++u) {
+                auto [begin, end] = tokensOf(u);
+                writeAsciiRange(ids.data() + begin, end - begin, unitStart[u], text.data());
+            }
+        });
+        if (text.empty()) text = "\n";   // no tokens: a lone newline, as in finish()
+        os_.write(text.data(), text.size());
+        if (!os_) return FAILED_TO_WRITE_FILE;
+        return NO_ERROR;
+    }
+
+    std::vector<unsigned char> bytes(static_cast<size_t>((endBit + 7) / 8), 0);
+    const bool shared = format_ != Format::Blocks;
+    std::vector<std::array<unsigned char, 2>> edges(units, {0, 0});
+    std::vector<uint32_t> crcs(format_ == Format::Blocks ? units : 0);
+    runOnThreads(workers, [&](size_t w) {
+        auto [firstUnit, lastUnit] = unitsOf(w);
+        for (size_t u = firstUnit; u < lastUnit; ++u) {
+            auto [begin, end] = tokensOf(u);
+            packRange(ids.data() + begin, end - begin, unitStart[u], bytes.data(), shared, edges[u].data());
+            if (!shared) {
+                crcs[u] = BlockIndex::crc32(bytes.data() + unitStart[u] / 8, (unitBits[u + 1] + 7) / 8);
+            }
+        }
+    });
+
+    if (format_ == Format::Binary) {
+        for (size_t u = 0; u < units; ++u) {
+            if (unitStart[u] % 8) bytes[unitStart[u] / 8] |= edges[u][0];
+            if (unitStart[u + 1] % 8) bytes[unitStart[u + 1] / 8] |= edges[u][1];
+        }
+        os_.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+        return BitWriter::writeTrailer(os_, totalBits_);
+    }
+
+    for (size_t u = 0; u < units; ++u) {
+        auto [begin, end] = tokensOf(u);
+        index_.blocks.push_back(BlockEntry{unitStart[u], unitBits[u + 1], begin,
+                                           static_cast<uint32_t>(end - begin), crcs[u]});
+    }
+    os_.write(reinterpret_cast<const char*>(bytes.data()), bytes.size());
+    return index_.write(os_);
+}
@@ -0,0 +1,127 @@
+#ifndef TOKENENCODER_HPP
+#define TOKENENCODER_HPP
+
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "utils.hpp"
+#include "BitWriter.hpp"
+#include "BlockIndex.hpp"
+
+// Encodes tokens one at a time with a fixed codebook, so a caller can stream
+// tokens straight from the Scanner instead of collecting them first.
+// Output is the ASCII '0'/'1' layout of HuffmanTree::encode (wrapped at
+// wrap_cols), the packed BitWriter stream, or the block container described
+// in BlockIndex.hpp.
+class TokenEncoder {
+public:
+    enum class Format { Ascii, Binary, Blocks };
+
+    // 'codebook' is (word, '0'/'1' code) pairs, e.g. from HuffmanTree::assignCodes.
+    // 'tokensPerBlock' and 'bytesPerBlock' are only used by Format::Blocks:
+    // a block ends after tokensPerBlock tokens, or with the token that takes
+    // its payload to bytesPerBlock bytes, whichever comes first (0 = no bound).
+    TokenEncoder(const std::vector<std::pair<std::string, std::string>>& codebook,
+                 std::ostream& os, Format format, int wrap_cols = 80,
+                 uint64_t tokensPerBlock = 0, uint64_t bytesPerBlock = 0);
+
+    // Codes given as (code, length) pairs, right-aligned, at most 64 bits
+    // (e.g. from CanonicalCode). Only putId()/encodeIds() can be used: there
+    // are no words to look tokens up by.
+    TokenEncoder(const std::vector<std::pair<uint64_t, int>>& codes,
+                 std::ostream& os, Format format, int wrap_cols = 80,
+                 uint64_t tokensPerBlock = 0, uint64_t bytesPerBlock = 0);
+
+    // Append the code of 'token'; FAILED_TO_WRITE_FILE if it has none
+    error_type put(std::string_view token);
+
+    // Append the code of codebook entry 'id' (its index in 'codebook'). With a
+    // codebook ordered by TokenInterner ID, token IDs are used directly.
+    error_type putId(uint32_t id);
+
+    // Append 'length' bits (right-aligned in 'code', at most 64) that are
+    // not from the codebook, e.g. an adaptive code. ASCII and binary only.
+    void putCode(uint64_t code, int length);
+
+    // Write out every complete line (ASCII) or byte (binary) so far and flush
+    // the stream, so that a reader sees the codes of the tokens put so far
+    error_type flush();
+
+    // Continue an ASCII or binary stream that already holds 'bitsBefore' bits,
+    // before the first put. 'pending' ('0'/'1') is its unfinished last line
+    // (ASCII) or byte (binary), which the caller has cut from the file and
+    // which is written again first. Only finish() after putting a token.
+    void resume(std::string_view pending, uint64_t bitsBefore);
+
+    // Write what is buffered (and the binary trailer or block index)
+    error_type finish();
+
+    // Encode all of 'tokens' and finish, on 'threads' threads; use instead of
+    // put()/finish(). Output is identical to the serial path: each token's
+    // code is looked up first, an exclusive prefix sum of code lengths gives
+    // every slice its starting bit, and each thread writes its slice into one
+    // output buffer. Bytes shared by two slices are merged afterwards.
+    error_type encodeAll(const std::vector<std::string_view>& tokens, unsigned threads);
+
+    // Same, for codebook entry IDs (see putId)
+    error_type encodeIds(const std::vector<uint32_t>& ids, unsigned threads);
+
+    uint64_t totalBits() const { return totalBits_; }
+
+private:
+    // Codes are packed into 64-bit chunks; tree codes may span several
+    struct PackedCode {
+        size_t firstChunk;
+        size_t length;
+    };
+
+    void setUpOutput();
+    void putAscii(const PackedCode& code);
+    void putAsciiBit(bool bit);
+    void putBits(const PackedCode& code);
+    error_type endBlock();
+    bool blockFull() const {
+        return blockTokens_ == tokensPerBlock_ ||
+               (bytesPerBlock_ > 0 && totalBits_ - blockStartBits_ >= bytesPerBlock_ * 8);
+    }
+    bool bitAt(const PackedCode& code, size_t i) const {
+        const size_t chunkBits = std::min<size_t>(64, code.length - i / 64 * 64);
+        return (chunks_[code.firstChunk + i / 64] >> (chunkBits - 1 - i % 64)) & 1;
+    }
+    void packRange(const uint32_t* ids, size_t count, uint64_t startBit,
+                   unsigned char* out, bool sharedEdges, unsigned char edges[2]) const;
+    void writeAsciiRange(const uint32_t* ids, size_t count, uint64_t startBit, char* out) const;
+
+    std::vector<std::string> words_;
+    std::vector<uint64_t> chunks_;
+    std::vector<PackedCode> codes_;
+    std::unordered_map<std::string_view, uint32_t> lookup_;
+
+    std::ostream& os_;
+    Format format_;
+    int wrapCols_;
+    std::string line_;
+    std::unique_ptr<BitWriter> bits_;
+    uint64_t tokens_;
+    uint64_t totalBits_;
+
+    // Format::Blocks: the current block is packed into blockStream_, then
+    // copied to os_ with its index entry once it is full (see blockFull)
+    std::ostringstream blockStream_;
+    BlockIndex index_;
+    uint64_t tokensPerBlock_;
+    uint64_t bytesPerBlock_;
+    uint64_t blockTokens_;
+    uint64_t blockStartBits_;
+    uint64_t bytesWritten_;
+};
+
+#endif // TOKENENCODER_HPP
@@ -0,0 +1,71 @@
+#include "TokenInterner.hpp"
+#include "HashCounter.hpp"
+
+TokenInterner::TokenInterner() : slots_(1024, 0) {}
+
+uint32_t TokenInterner::findSlot(std::string_view word, uint64_t hash, size_t& slot) const {
+    const size_t mask = slots_.size() - 1;
+    slot = hash & mask;
+    while (slots_[slot] != 0) {
+        const uint32_t id = slots_[slot] - 1;
+        if (hashes_[id] == hash && lengths_[id] == word.size() && this->word(id) == word) {
+            return id;
+        }
+        slot = (slot + 1) & mask;
+    }
+    return kNoId;
+}
+
+uint32_t TokenInterner::intern(std::string_view word) {
+    const uint64_t hash = HashCounter::hashWord(word);
+    size_t slot;
+    if (uint32_t id = findSlot(word, hash, slot); id != kNoId) {
+        return id;
+    }
+
+    // Keep the load factor at or below 1/2
+    if ((size() + 1) * 2 > slots_.size()) {
+        grow();
+        findSlot(word, hash, slot);
+    }
+
+    const uint32_t id = static_cast<uint32_t>(size());
+    slots_[slot] = id + 1;
+    hashes_.push_back(hash);
+    offsets_.push_back(words_.add(word));
+    lengths_.push_back(static_cast<uint32_t>(word.size()));
+    return id;
+}
+
+uint32_t TokenInterner::find(std::string_view word) const {
+    size_t slot;
+    return findSlot(word, HashCounter::hashWord(word), slot);
+}
+
+void TokenInterner::grow() {
+    slots_.assign(slots_.size() * 2, 0);
+    const size_t mask = slots_.size() - 1;
+    for (uint32_t id = 0; id < size(); ++id) {
+        size_t slot = hashes_[id] & mask;
+        while (slots_[slot] != 0) {
+            slot = (slot + 1) & mask;
+        }
+        slots_[slot] = id + 1;
+    }
+}
+
+error_type TokenInterner::writeTokens(std::ostream& out, const std::vector<uint32_t>& ids) const {
+    // Lines are gathered into large writes
+    std::string pending;
+    for (uint32_t id : ids) {
+        pending.append(word(id)).push_back('\n');
+        if (pending.size() >= (1 << 16)) {
+            out.write(pending.data(), pending.size());
+            pending.clear();
+        }
+    }
+    out.write(pending.data(), pending.size());
+
+    if (!out) return FAILED_TO_WRITE_FILE;
+    return NO_ERROR;
+}
@@ -0,0 +1,53 @@
+#ifndef TOKENINTERNER_HPP
+#define TOKENINTERNER_HPP
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "utils.hpp"
+#include "StringArena.hpp"
+
+// Maps each distinct word to a dense uint32_t ID, in order of first
+// occurrence, with every word stored once in a StringArena. Later stages
+// work on the ID stream and on flat arrays indexed by ID; strings are only
+// needed again to write the output files.
+//
+// Lookup is open addressing (linear probing) over slots holding ID + 1, with
+// each word's 64-bit hash kept per ID so probes and growth rarely touch the
+// key bytes.
+class TokenInterner {
+public:
+    static constexpr uint32_t kNoId = UINT32_MAX;
+
+    TokenInterner();
+
+    // ID of 'word', adding it if it is new
+    uint32_t intern(std::string_view word);
+
+    // ID of 'word', or kNoId if it was never interned
+    uint32_t find(std::string_view word) const;
+
+    // Number of distinct words (IDs are 0 .. size() - 1)
+    size_t size() const { return hashes_.size(); }
+
+    // The word with this ID (invalidated by the next intern() of a new word)
+    std::string_view word(uint32_t id) const { return words_.view(offsets_[id], lengths_[id]); }
+
+    // Write one word per line for each ID in 'ids' (the .tokens layout)
+    error_type writeTokens(std::ostream& out, const std::vector<uint32_t>& ids) const;
+
+private:
+    uint32_t findSlot(std::string_view word, uint64_t hash, size_t& slot) const;
+    void grow();
+
+    std::vector<uint32_t> slots_;    // ID + 1, or 0 for empty; power-of-two size
+    std::vector<uint64_t> hashes_;   // per ID
+    std::vector<uint64_t> offsets_;  // per ID, into words_
+    std::vector<uint32_t> lengths_;  // per ID
+    StringArena words_;
+};
+
+#endif // TOKENINTERNER_HPP
@@ -0,0 +1,173 @@
+#include "CorpusGenerator.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <random>
+#include <utility>
+#include <vector>
+
+namespace {
+
+// Uniform double in [0, 1) from the top 53 bits
+double uniform(std::mt19937_64& rng) {
+    return static_cast<double>(rng() >> 11) * 0x1.0p-53;
+}
+
+// Cumulative Zipf weights over 'vocabulary' ranks
+std::vector<double> zipfCdf(size_t vocabulary, double exponent) {
+    std::vector<double> cdf(vocabulary);
+    double total = 0.0;
+    for (size_t rank = 0; rank < vocabulary; ++rank) {
+        total += 1.0 / std::pow(static_cast<double>(rank + 1), exponent);
+        cdf[rank] = total;
+    }
+    return cdf;
+}
+
+size_t drawRank(const std::vector<double>& cdf, std::mt19937_64& rng) {
+    const double target = uniform(rng) * cdf.back();
+    const size_t rank = std::upper_bound(cdf.begin(), cdf.end(), target) - cdf.begin();
+    return std::min(rank, cdf.size() - 1);
+}
+
+// Append one token and the separator after it. Capitals and punctuation are
+// driven by 'roll' so the text stays a pure function of the seed.
+void appendToken(std::string& text, const std::string& word, uint64_t roll) {
+    const size_t start = text.size();
+    text += word;
+    if (roll % 12 == 0) {
+        text[start] = static_cast<char>(text[start] - 'a' + 'A');
+    }
+    switch ((roll >> 8) % 16) {
+        case 0:  text += ".\n"; break;
+        case 1:  text += ", "; break;
+        case 2:  text += " -- "; break;
+        default: text += ' '; break;
+    }
+}
+
+} // namespace
+
+CorpusGenerator::CorpusGenerator(const CorpusSpec& spec) : spec_(spec) {
+    spec_.vocabulary = std::max<size_t>(spec_.vocabulary, 1);
+}
+
+std::string CorpusGenerator::wordFor(size_t rank) {
+    // Bijective base 26 of rank + 1 ("a".."z", "aa".."zz", ...), reversed so
+    // the lexicographic order of words does not follow their rank
+    std::string word;
+    for (size_t n = rank + 1; n > 0; n = (n - 1) / 26) {
+        word += static_cast<char>('a' + (n - 1) % 26);
+    }
+    return word;
+}
+
+const char* CorpusGenerator::kindName(CorpusKind kind) {
+    switch (kind) {
+        case CorpusKind::Zipf:        return "zipf";
+        case CorpusKind::Sorted:      return "sorted";
+        case CorpusKind::Adversarial: return "adversarial";
+    }
+    return "unknown";
+}
+
+bool CorpusGenerator::parseKind(const std::string& name, CorpusKind& kind) {
+    for (CorpusKind candidate : {CorpusKind::Zipf, CorpusKind::Sorted, CorpusKind::Adversarial}) {
+        if (name == kindName(candidate)) {
+            kind = candidate;
+            return true;
+        }
+    }
+    return false;
+}
+
+void CorpusGenerator::generate(std::string& text) const {
+    text.clear();
+    switch (spec_.kind) {
+        case CorpusKind::Zipf:        generateZipf(text); break;
+        case CorpusKind::Sorted:      generateSorted(text); break;
+        case CorpusKind::Adversarial: generateAdversarial(text); break;
+    }
+}
+
+error_type CorpusGenerator::writeTo(const std::string& filename) const {
+    std::string text;
+    generate(text);
+
+    std::ofstream out(filename, std::ios::binary);
+    if (!out.is_open()) {
+        return UNABLE_TO_OPEN_FILE_FOR_WRITING;
+    }
+    out.write(text.data(), static_cast<std::streamsize>(text.size()));
+    return out ? NO_ERROR : FAILED_TO_WRITE_FILE;
+}
+
+void CorpusGenerator::generateZipf(std::string& text) const {
+    std::mt19937_64 rng(spec_.seed);
+    const std::vector<double> cdf = zipfCdf(spec_.vocabulary, spec_.exponent);
+
+    std::vector<std::string> words(spec_.vocabulary);
+    for (size_t rank = 0; rank < words.size(); ++rank) {
+        words[rank] = wordFor(rank);
+    }
+
+    text.reserve(spec_.tokens * 6);
+    for (size_t i = 0; i < spec_.tokens; ++i) {
+        const size_t rank = drawRank(cdf, rng);
+        appendToken(text, words[rank], rng());
+    }
+}
+
+void CorpusGenerator::generateSorted(std::string& text) const {
+    std::mt19937_64 rng(spec_.seed);
+    const std::vector<double> cdf = zipfCdf(spec_.vocabulary, spec_.exponent);
+
+    std::vector<size_t> counts(spec_.vocabulary, 0);
+    for (size_t i = 0; i < spec_.tokens; ++i) {
+        ++counts[drawRank(cdf, rng)];
+    }
+
+    // Runs of each word, words in ascending order: every new word is the
+    // largest so far, so the unbalanced BST degenerates into a list
+    std::vector<std::pair<std::string, size_t>> runs;
+    for (size_t rank = 0; rank < counts.size(); ++rank) {
+        if (counts[rank] > 0) {
+            runs.emplace_back(wordFor(rank), counts[rank]);
+        }
+    }
+    std::sort(runs.begin(), runs.end());
+
+    text.reserve(spec_.tokens * 6);
+    for (const auto& [word, count] : runs) {
+        for (size_t i = 0; i < count; ++i) {
+            appendToken(text, word, rng());
+        }
+    }
+}
+
+void CorpusGenerator::generateAdversarial(std::string& text) const {
+    std::mt19937_64 rng(spec_.seed);
+
+    std::vector<std::string> words(spec_.vocabulary);
+    for (size_t rank = 0; rank < words.size(); ++rank) {
+        words[rank] = wordFor(rank);
+    }
+    std::sort(words.begin(), words.end());
+
+    // Fibonacci counts make each merge of the Huffman build absorb the
+    // previous one, so the tree gets one level deeper per word
+    constexpr size_t kFibonacciWords = 26;
+    size_t previous = 1;
+    size_t current = 1;
+    for (size_t i = 0; i < words.size(); ++i) {
+        size_t count = 1;
+        if (i < kFibonacciWords) {
+            count = current;
+            current += std::exchange(previous, current);
+        }
+        for (size_t j = 0; j < count; ++j) {
+            appendToken(text, words[i], rng());
+        }
+    }
+}
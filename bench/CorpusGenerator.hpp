@@ -0,0 +1,66 @@
+#ifndef CORPUSGENERATOR_HPP
+#define CORPUSGENERATOR_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+#include "utils.hpp"
+
+// Shapes of synthetic corpora
+enum class CorpusKind {
+    Zipf,        // tokens drawn from a Zipf distribution, in random order
+    Sorted,      // the same kind of counts, emitted in lexicographic word order
+    Adversarial, // every word once in ascending order, plus Fibonacci counts
+                 // on the first words: a degenerate BST and the deepest Huffman tree
+};
+
+struct CorpusSpec {
+    CorpusKind kind = CorpusKind::Zipf;
+
+    // Tokens to draw (Zipf, Sorted); Adversarial has one token per word plus
+    // the Fibonacci repeats
+    size_t tokens = 2000000;
+
+    // Distinct words to draw from
+    size_t vocabulary = 50000;
+
+    // Zipf exponent s: the word of rank r has weight 1 / (r + 1)^s
+    double exponent = 1.0;
+
+    uint64_t seed = 315;
+};
+
+// Deterministic corpus generator: the same spec gives byte-identical text on
+// every platform (mt19937_64 output is fixed by the standard, and no
+// std::*_distribution is used).
+//
+// Words are letters only and get longer with rank, so frequent words are
+// short. Every 12th token or so starts with a capital letter and some are
+// followed by punctuation, so the Scanner's lowercase and separator paths
+// are exercised too.
+class CorpusGenerator {
+public:
+    explicit CorpusGenerator(const CorpusSpec& spec);
+
+    // Generate the whole corpus into 'text'
+    void generate(std::string& text) const;
+
+    // Generate the corpus and write it to 'filename'
+    error_type writeTo(const std::string& filename) const;
+
+    // Distinct word for every rank (0 = most frequent)
+    static std::string wordFor(size_t rank);
+
+    static const char* kindName(CorpusKind kind);
+    static bool parseKind(const std::string& name, CorpusKind& kind);
+
+private:
+    void generateZipf(std::string& text) const;
+    void generateSorted(std::string& text) const;
+    void generateAdversarial(std::string& text) const;
+
+    CorpusSpec spec_;
+};
+
+#endif // CORPUSGENERATOR_HPP
@@ -0,0 +1,276 @@
+// Benchmark driver: generates synthetic corpora and times each phase of the
+// encoder on them. Results go to stdout as JSON Lines, one object per
+// (corpus, phase):
+//   {"corpus":"zipf","phase":"tokenize","tokens":...,"vocabulary":...,"bytes":...,
+//    "items":...,"seconds":...,"mb_per_s":...,"ns_per_token":...}
+// 'items' is what the phase works on. Phases over the corpus's tokens
+// (tokenize, counting, encode) report MB/s of the corpus and ns per token;
+// phases over the distinct words (queue, tree, codes) report "ns_per_word"
+// instead, as they never see the corpus bytes.
+//
+//   huffman_bench [--corpus=zipf|sorted|adversarial|all] [--tokens=N] [--vocab=N]
+//                 [--zipf=S] [--seed=N] [--repeat=N] [--dir=DIR] [--generate=FILE] [--help]
+//
+// --generate writes one corpus to FILE and exits (input for huffman_encoder).
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+#include <limits>
+#include <optional>
+#include <streambuf>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "CorpusGenerator.hpp"
+#include "Scanner.hpp"
+#include "BST.hpp"
+#include "PriorityQueue.hpp"
+#include "HuffmanTree.hpp"
+#include "utils.hpp"
+
+namespace {
+
+struct BenchOptions {
+    std::vector<CorpusKind> kinds = {CorpusKind::Zipf, CorpusKind::Sorted, CorpusKind::Adversarial};
+    std::optional<size_t> tokens;
+    std::optional<size_t> vocabulary;
+    double exponent = 1.0;
+    uint64_t seed = 315;
+    unsigned repeat = 3;
+    std::string dir = "bench";
+    std::string generateFile;
+    bool help = false;
+};
+
+// Stream buffer that drops everything: encode() is timed without file I/O
+class NullBuffer : public std::streambuf {
+protected:
+    int_type overflow(int_type c) override { return traits_type::not_eof(c); }
+    std::streamsize xsputn(const char*, std::streamsize n) override { return n; }
+};
+
+bool parseSize(const std::string& value, size_t& out) {
+    if (value.empty() || value.find_first_not_of("0123456789") != std::string::npos) {
+        return false;
+    }
+    try {
+        out = std::stoull(value);
+        return true;
+    } catch (const std::exception&) {
+        return false;
+    }
+}
+
+error_type parseBenchArguments(int argc, char* argv[], BenchOptions& options) {
+    for (int i = 1; i < argc; ++i) {
+        const std::string arg = argv[i];
+        const size_t eq = arg.find('=');
+        const std::string name = arg.substr(0, eq);
+        const std::string value = eq == std::string::npos ? "" : arg.substr(eq + 1);
+        size_t number = 0;
+
+        if (name == "--corpus") {
+            CorpusKind kind;
+            if (value == "all") {
+                options.kinds = {CorpusKind::Zipf, CorpusKind::Sorted, CorpusKind::Adversarial};
+            } else if (CorpusGenerator::parseKind(value, kind)) {
+                options.kinds = {kind};
+            } else {
+                return INVALID_ARGUMENTS;
+            }
+        } else if (name == "--tokens" && parseSize(value, number)) {
+            options.tokens = number;
+        } else if (name == "--vocab" && parseSize(value, number) && number > 0) {
+            options.vocabulary = number;
+        } else if (name == "--seed" && parseSize(value, number)) {
+            options.seed = number;
+        } else if (name == "--repeat" && parseSize(value, number) && number > 0 &&
+                   number <= std::numeric_limits<unsigned>::max()) {
+            options.repeat = static_cast<unsigned>(number);
+        } else if (name == "--zipf") {
+            try {
+                options.exponent = std::stod(value);
+            } catch (const std::exception&) {
+                return INVALID_ARGUMENTS;
+            }
+            if (!(options.exponent >= 0.0)) {
+                return INVALID_ARGUMENTS;
+            }
+        } else if (name == "--dir" && !value.empty()) {
+            options.dir = value;
+        } else if (name == "--generate" && !value.empty()) {
+            options.generateFile = value;
+        } else if (arg == "--help") {
+            options.help = true;
+        } else {
+            return INVALID_ARGUMENTS;
+        }
+    }
+    return NO_ERROR;
+}
+
+// Defaults per corpus kind: the sorted and adversarial corpora cost
+// O(tokens * vocabulary) in the unbalanced BST, so they stay smaller
+CorpusSpec specFor(CorpusKind kind, const BenchOptions& options) {
+    CorpusSpec spec;
+    spec.kind = kind;
+    spec.exponent = options.exponent;
+    spec.seed = options.seed;
+    switch (kind) {
+        case CorpusKind::Zipf:        spec.tokens = 2000000; spec.vocabulary = 50000; break;
+        case CorpusKind::Sorted:      spec.tokens = 1000000; spec.vocabulary = 2000; break;
+        case CorpusKind::Adversarial: spec.tokens = 0;       spec.vocabulary = 20000; break;
+    }
+    spec.tokens = options.tokens.value_or(spec.tokens);
+    spec.vocabulary = options.vocabulary.value_or(spec.vocabulary);
+    return spec;
+}
+
+// Best wall time of 'repeat' runs of body()
+template <typename Body>
+double timeBest(unsigned repeat, Body&& body) {
+    double best = std::numeric_limits<double>::infinity();
+    for (unsigned i = 0; i < repeat; ++i) {
+        const auto start = std::chrono::steady_clock::now();
+        body();
+        const std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        best = std::min(best, elapsed.count());
+    }
+    return best;
+}
+
+struct CorpusInfo {
+    const char* name;
+    size_t tokens;
+    size_t vocabulary;
+    size_t bytes;
+};
+
+// What a phase works through: every token of the corpus, or its distinct words
+enum class PhaseUnit { Token, Word };
+
+void report(const CorpusInfo& corpus, const char* phase, PhaseUnit unit, double seconds) {
+    std::printf("{\"corpus\":\"%s\",\"phase\":\"%s\",\"tokens\":%zu,\"vocabulary\":%zu,\"bytes\":%zu,",
+                corpus.name, phase, corpus.tokens, corpus.vocabulary, corpus.bytes);
+    if (unit == PhaseUnit::Token) {
+        const double mbPerSecond = seconds > 0 ? corpus.bytes / seconds / 1e6 : 0.0;
+        const double nsPerToken = corpus.tokens > 0 ? seconds * 1e9 / corpus.tokens : 0.0;
+        std::printf("\"items\":%zu,\"seconds\":%.6f,\"mb_per_s\":%.2f,\"ns_per_token\":%.2f}\n",
+                    corpus.tokens, seconds, mbPerSecond, nsPerToken);
+    } else {
+        const double nsPerWord = corpus.vocabulary > 0 ? seconds * 1e9 / corpus.vocabulary : 0.0;
+        std::printf("\"items\":%zu,\"seconds\":%.6f,\"ns_per_word\":%.2f}\n",
+                    corpus.vocabulary, seconds, nsPerWord);
+    }
+    std::fflush(stdout);
+}
+
+void benchCorpus(const CorpusSpec& spec, const BenchOptions& options) {
+    const char* name = CorpusGenerator::kindName(spec.kind);
+    const std::string path = options.dir + "/corpus_" + name + ".txt";
+    if (error_type status = CorpusGenerator(spec).writeTo(path); status != NO_ERROR) {
+        exitOnError(status, path);
+    }
+
+    // Scanner::tokenize: mapping, scanning, lowercasing
+    std::vector<std::string_view> words;
+    Scanner scanner(path);
+    error_type status = NO_ERROR;
+    const double tokenizeSeconds = timeBest(options.repeat, [&] {
+        words.clear();
+        status = scanner.tokenize(words);
+    });
+    if (status != NO_ERROR) {
+        exitOnError(status, path);
+    }
+
+    BST bst;
+    bst.buildFromTokens(words);
+    std::vector<std::pair<std::string, size_t>> frequencies = bst.getFrequencies();
+
+    const CorpusInfo corpus{name, words.size(), frequencies.size(), std::filesystem::file_size(path)};
+    report(corpus, "tokenize", PhaseUnit::Token, tokenizeSeconds);
+
+    // BST::buildFromTokens, once per counting backend
+    const std::pair<const char*, CounterBackend> backends[] = {
+        {"bst_build", CounterBackend::Tree},
+        {"bst_build_avl", CounterBackend::Avl},
+        {"bst_build_hash", CounterBackend::Hash},
+    };
+    for (const auto& [phase, backend] : backends) {
+        const double seconds = timeBest(options.repeat, [&] {
+            BST counter(backend);
+            counter.buildFromTokens(words);
+        });
+        report(corpus, phase, PhaseUnit::Token, seconds);
+    }
+
+    // PriorityQueue::buildQueue
+    report(corpus, "pq_build", PhaseUnit::Word, timeBest(options.repeat, [&] {
+        PriorityQueue pq;
+        pq.buildQueue(frequencies);
+    }));
+
+    // HuffmanTree::buildFromFrequencies, fed the lexicographic list as main does
+    report(corpus, "huffman_build", PhaseUnit::Word, timeBest(options.repeat, [&] {
+        HuffmanTree tree;
+        tree.buildFromFrequencies(frequencies);
+    }));
+
+    HuffmanTree huffman;
+    huffman.buildFromFrequencies(frequencies);
+
+    std::vector<std::pair<std::string, std::string>> codebook;
+    report(corpus, "assign_codes", PhaseUnit::Word, timeBest(options.repeat, [&] {
+        codebook.clear();
+        huffman.assignCodes(codebook);
+    }));
+
+    // HuffmanTree::encode (ASCII) and encodeBinary, into a discarding stream
+    NullBuffer sink;
+    std::ostream out(&sink);
+    report(corpus, "encode", PhaseUnit::Token, timeBest(options.repeat, [&] {
+        status = huffman.encode(words, out);
+    }));
+    if (status != NO_ERROR) {
+        exitOnError(status, "encode");
+    }
+    report(corpus, "encode_binary", PhaseUnit::Token, timeBest(options.repeat, [&] {
+        status = huffman.encodeBinary(words, out);
+    }));
+    if (status != NO_ERROR) {
+        exitOnError(status, "encode_binary");
+    }
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    BenchOptions options;
+    const bool valid = parseBenchArguments(argc, argv, options) == NO_ERROR;
+    if (!valid || options.help) {
+        (valid ? std::cout : std::cerr)
+            << "usage: " << argv[0]
+            << " [--corpus=zipf|sorted|adversarial|all] [--tokens=N] [--vocab=N] [--zipf=S]"
+               " [--seed=N] [--repeat=N] [--dir=DIR] [--generate=FILE] [--help]\n";
+        return valid ? 0 : 1;
+    }
+
+    if (!options.generateFile.empty()) {
+        const CorpusSpec spec = specFor(options.kinds.front(), options);
+        if (error_type status = CorpusGenerator(spec).writeTo(options.generateFile); status != NO_ERROR) {
+            exitOnError(status, options.generateFile);
+        }
+        return 0;
+    }
+
+    for (CorpusKind kind : options.kinds) {
+        benchCorpus(specFor(kind, options), options);
+    }
+    return 0;
+}
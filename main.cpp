@@ -1,155 +1,170 @@
 #include <iostream>
+#include <algorithm>
 #include <fstream>
-#include <filesystem>
 #include <string>
+#include <string_view>
 #include <vector>
-#include <map>                    // *** NEW FOR PHASE 3: For codebook map ***
 
-#include "Scanner.hpp"
-#include "BST.hpp"
-#include "PriorityQueue.hpp"
-#include "HuffmanTree.hpp"        // *** NEW FOR PHASE 3: Include Huffman tree ***
+#include "Options.hpp"
+#include "AdaptiveCoder.hpp"
+#include "HuffmanDecoder.hpp"
+#include "SharedDictionary.hpp"
+#include "Pipeline.hpp"
+#include "Stats.hpp"
 #include "utils.hpp"
 
 int main(int argc, char *argv[]) {
     // 1) Parse and validate arguments
-    if (argc != 2) {
-        std::cerr << "Usage: " << argv[0] << " <filename>\n";
+    Options options;
+    if (parseArguments(argc, argv, options) != NO_ERROR) {
+        printUsage(argv[0]);
         return 1;
     }
+    if (options.statsJson) {
+        Stats::enable();
+    }
 
     const std::string dirName = std::string("input_output");
-    const std::string inputFileName = std::string(argv[1]);
+    const std::string inputFileName = options.inputFileName;
     const std::string inputFileBaseName = baseNameWithoutTxt(inputFileName);
 
-    // Build paths for output files
-    const std::string wordTokensFileName = dirName + "/" + inputFileBaseName + ".tokens";
-    const std::string freqFileName = dirName + "/" + inputFileBaseName + ".freq";
-    const std::string hdrFileName = dirName + "/" + inputFileBaseName + ".hdr";      // *** NEW FOR PHASE 3 ***
-    const std::string codeFileName = dirName + "/" + inputFileBaseName + ".code";    // *** NEW FOR PHASE 3 ***
-
-    // Verify input file, directory exist and output files are writable
-    if (error_type status; (status = regularFileExistsAndIsAvailable(inputFileName)) != NO_ERROR)
-        exitOnError(status, inputFileName);
+    // --decode: read .hdr + .code back into tokens, one per line like .tokens
+    // (every encoding mode builds its own paths in Pipeline.cpp)
+    if (options.decode) {
+        const std::string hdrFileName = dirName + "/" + inputFileBaseName + ".hdr";
+        const std::string codeFileName = dirName + "/" + inputFileBaseName + ".code";
+        const std::string decodedFileName = dirName + "/" + inputFileBaseName + ".decoded";
+        const bool adaptive = options.adaptive;
+        if (error_type status; options.dictionaryFileName.empty() && !adaptive &&
+                               (status = regularFileExistsAndIsAvailable(hdrFileName)) != NO_ERROR)
+            exitOnError(status, hdrFileName);
+
+        // An --approx or --hybrid .hdr is a shared dictionary of its own
+        const std::string dictionaryFileName = !options.dictionaryFileName.empty() ? options.dictionaryFileName
+            : !adaptive && isDictionaryFile(hdrFileName) ? hdrFileName : std::string();
+        const bool shared = !dictionaryFileName.empty();
+
+        if (error_type status; (status = regularFileExistsAndIsAvailable(codeFileName)) != NO_ERROR)
+            exitOnError(status, codeFileName);
+
+        // The code comes from the .hdr, or from the shared dictionary with
+        // --dict (or --approx, --hybrid); an --adaptive stream carries its own code
+        Stats::Phase phase("header");
+        HuffmanDecoder decoder;
+        SharedDictionary dictionary;
+        AdaptiveCoder coder;
+        if (shared) {
+            if (error_type status; (status = loadDictionary(dictionaryFileName, dictionary)) != NO_ERROR)
+                exitOnError(status, dictionaryFileName);
+        } else if (!adaptive) {
+            std::ifstream hdrFile(hdrFileName);
+            if (error_type status; (status = decoder.readHeader(hdrFile)) != NO_ERROR)
+                exitOnError(status, hdrFileName);
+            Stats::addFileRead(hdrFileName);
+        }
 
-    if (error_type status; (status = directoryExists(dirName)) != NO_ERROR)
-        exitOnError(status, dirName);
+        phase.next("decode");
+        std::vector<std::string_view> decoded;
+        if (shared || adaptive) {
+            if (error_type status; (status = adaptive ? coder.decodeFile(codeFileName, decoded)
+                                                      : dictionary.decodeFile(codeFileName, decoded)) != NO_ERROR)
+                exitOnError(status, codeFileName);
+
+            // These streams have no block index: decode it all and cut
+            if (options.range) {
+                const size_t first = static_cast<size_t>(std::min<uint64_t>(options.rangeFirst, decoded.size()));
+                const size_t count = static_cast<size_t>(std::min<uint64_t>(options.rangeCount, decoded.size() - first));
+                decoded.erase(decoded.begin() + first + count, decoded.end());
+                decoded.erase(decoded.begin(), decoded.begin() + first);
+            }
+        } else if (error_type status; (status = options.range
+                ? decoder.decodeRange(codeFileName, options.rangeFirst, options.rangeCount, decoded)
+                : decoder.decodeFile(codeFileName, decoded, options.threads)) != NO_ERROR) {
+            exitOnError(status, codeFileName);
+        }
 
-    if (error_type status; (status = canOpenForWriting(wordTokensFileName)) != NO_ERROR)
-        exitOnError(status, wordTokensFileName);
+        phase.next("write_decoded");
+        if (error_type status; (status = writeVectorToFile(decodedFileName, decoded)) != NO_ERROR)
+            exitOnError(status, decodedFileName);
+        phase.end();
 
-    if (error_type status; (status = canOpenForWriting(freqFileName)) != NO_ERROR)
-        exitOnError(status, freqFileName);
+        std::cout << "Decoded tokens: " << decoded.size() << '\n';
+        if (options.statsJson) {
+            Stats::addFileRead(codeFileName);
+            Stats::addFileWritten(decodedFileName);
+            Stats::writeJson(std::cerr, inputFileName);
+        }
+        return 0;
+    }
 
-    // *** NEW FOR PHASE 3: Verify new output files are writable ***
-    if (error_type status; (status = canOpenForWriting(hdrFileName)) != NO_ERROR)
-        exitOnError(status, hdrFileName);
+    // --batch: many files in one process, on a work-stealing pool
+    if (options.batch) {
+        std::string errorEntity;
+        bool fatal = false;
+        error_type status = encodeBatch(options, std::cout, std::cerr, errorEntity, fatal);
+        if (options.statsJson) {
+            Stats::writeJson(std::cerr, "batch");
+        }
+        if (fatal) {
+            exitOnError(status, errorEntity);
+        }
+        return status == NO_ERROR ? 0 : 1;
+    }
 
-    if (error_type status; (status = canOpenForWriting(codeFileName)) != NO_ERROR)
-        exitOnError(status, codeFileName);
-    // *** END NEW FOR PHASE 3 ***
+    // --train: write a shared dictionary instead of encoding
+    if (!options.trainFileName.empty()) {
+        std::string errorEntity;
+        if (error_type status; (status = trainDictionary(options, inputFileName, std::cout, errorEntity)) != NO_ERROR)
+            exitOnError(status, errorEntity);
+        if (options.statsJson) {
+            Stats::writeJson(std::cerr, inputFileName);
+        }
+        return 0;
+    }
 
-    // 2) Scanner: tokenize input file
-    std::vector<std::string> words;
-    auto fileToWords = Scanner(std::filesystem::path(inputFileName));
-    
-    if (error_type status; (status = fileToWords.tokenize(words)) != NO_ERROR)
+    // Verify input file and directory exist (--adaptive also reads pipes)
+    if (error_type status; !options.adaptive && (status = regularFileExistsAndIsAvailable(inputFileName)) != NO_ERROR)
         exitOnError(status, inputFileName);
 
-    // Write tokens to .tokens file
-    if (error_type status; (status = writeVectorToFile(wordTokensFileName, words)) != NO_ERROR)
-        exitOnError(status, wordTokensFileName);
-
-    // 3) BST: build tree from tokens and compute frequencies
-    BST bst;
-    bst.buildFromTokens(words);
-    
-    // Get frequency data
-    auto frequencies = bst.getFrequencies();
-    
-    // 4) Print BST measures to stdout
-    size_t totalTokens = words.size();
-    size_t uniqueWords = bst.getUniqueWords();
-    int bstHeight = bst.getHeight();
-    size_t minFreq, maxFreq;
-    bst.getMinMaxFrequency(minFreq, maxFreq);
-    
-    std::cout << "BST height: " << bstHeight << '\n';
-    std::cout << "BST unique words: " << uniqueWords << '\n';
-    std::cout << "Total tokens: " << totalTokens << '\n';
-    std::cout << "Min frequency: " << minFreq << '\n';
-    std::cout << "Max frequency: " << maxFreq << '\n';
-
-    // 5) PriorityQueue: sort by count (desc) then word (asc), write to .freq
-    PriorityQueue pq;
-    pq.buildQueue(frequencies);
-    
-    if (error_type status; (status = pq.writeToFile(freqFileName)) != NO_ERROR)
-        exitOnError(status, freqFileName);
-
-    // ============================================================================
-    // *** NEW FOR PHASE 3: Build Huffman Tree and Encode ***
-    // ============================================================================
-    
-    // 6) Build Huffman tree from frequencies
-    HuffmanTree huffman;
-    huffman.buildFromFrequencies(frequencies);
-    
-    // Print Huffman tree height
-    int huffmanHeight = huffman.getHeight();
-    std::cout << "Huffman tree height: " << huffmanHeight << '\n';
-    
-    // 7) Write header file (.hdr) - codebook with word->code mappings
-    std::ofstream hdrFile(hdrFileName);
-    if (!hdrFile.is_open()) {
-        exitOnError(UNABLE_TO_OPEN_FILE_FOR_WRITING, hdrFileName);
-    }
-    
-    if (error_type status; (status = huffman.writeHeader(hdrFile)) != NO_ERROR) {
-        exitOnError(status, hdrFileName);
-    }
-    hdrFile.close();
-    
-    // 8) Encode tokens and write to .code file
-    std::ofstream codeFile(codeFileName);
-    if (!codeFile.is_open()) {
-        exitOnError(UNABLE_TO_OPEN_FILE_FOR_WRITING, codeFileName);
-    }
-    
-    if (error_type status; (status = huffman.encode(words, codeFile, 80)) != NO_ERROR) {
-        exitOnError(status, codeFileName);
-    }
-    codeFile.close();
-    
-    // 9) Calculate and print additional statistics
-    // Calculate total letters in all words
-    size_t totalLetters = 0;
-    for (const auto& word : words) {
-        totalLetters += word.length();
-    }
-    std::cout << "Total letters in words: " << totalLetters << '\n';
-    
-    // Calculate total encoded bits
-    std::vector<std::pair<std::string, std::string>> codebook;
-    huffman.assignCodes(codebook);
-    
-    // Build a map for quick lookup
-    std::map<std::string, std::string> codeMap;
-    for (const auto& pair : codebook) {
-        codeMap[pair.first] = pair.second;
+    if (error_type status; (status = directoryExists(dirName)) != NO_ERROR)
+        exitOnError(status, dirName);
+
+    // 2) - 9) Tokenize, count, build the code, write the outputs and report.
+    //    With --dict: one pass against the shared dictionary instead. With
+    //    --append: only the bytes added since the last --append run. With
+    //    --adaptive: one pass with codes that adapt as it goes, and no .hdr.
+    //    With --approx: bounded-memory counting, and the rare words escaped.
+    //    With --hybrid: exact counting, and the rare words escaped.
+    EncodeSummary summary;
+    std::string errorEntity;
+    if (!options.dictionaryFileName.empty()) {
+        Stats::Phase phase("load_dictionary");
+        SharedDictionary dictionary;
+        if (error_type status; (status = loadDictionary(options.dictionaryFileName, dictionary)) != NO_ERROR)
+            exitOnError(status, options.dictionaryFileName);
+        phase.end();
+        if (error_type status; (status = encodeWithDictionary(options, dictionary, inputFileName, std::cout,
+                                                              summary, errorEntity)) != NO_ERROR)
+            exitOnError(status, errorEntity);
+    } else if (options.adaptive) {
+        if (error_type status; (status = encodeAdaptive(options, inputFileName, std::cout, summary, errorEntity)) != NO_ERROR)
+            exitOnError(status, errorEntity);
+    } else if (options.approxWords > 0) {
+        if (error_type status; (status = encodeApproximate(options, inputFileName, std::cout, summary, errorEntity)) != NO_ERROR)
+            exitOnError(status, errorEntity);
+    } else if (options.hybrid) {
+        if (error_type status; (status = encodeHybrid(options, inputFileName, std::cout, summary, errorEntity)) != NO_ERROR)
+            exitOnError(status, errorEntity);
+    } else if (options.append) {
+        if (error_type status; (status = encodeAppend(options, inputFileName, std::cout, summary, errorEntity)) != NO_ERROR)
+            exitOnError(status, errorEntity);
+    } else if (error_type status; (status = encodeFile(options, inputFileName, std::cout, summary, errorEntity)) != NO_ERROR) {
+        exitOnError(status, errorEntity);
     }
-    
-    size_t totalBits = 0;
-    for (const auto& word : words) {
-        auto it = codeMap.find(word);
-        if (it != codeMap.end()) {
-            totalBits += it->second.length();
-        }
+
+    if (options.statsJson) {
+        Stats::writeJson(std::cerr, inputFileName);
     }
-    std::cout << "Total encoded bits: " << totalBits << '\n';
-    
-    // *** END NEW FOR PHASE 3 ***
-    // ============================================================================
 
     // 10) Success
     return 0;
@@ -7,32 +7,75 @@
 #include <fstream>
 #include <vector>
 #include "utils.hpp"
+#include "OutputFile.hpp"
 
 
-void exitOnError(error_type error, const std::string &entityName = "") {
+std::string errorMessage(error_type error, const std::string& entityName) {
     switch (error) {
         case NO_ERROR:
-            // do nothing
-            return;
+            return "";
 
         case FILE_NOT_FOUND:
-            std::cerr << "Error: File " << entityName << " doesn't exist. Terminating...\n";
-            exit(FILE_NOT_FOUND);
+            return "File " + entityName + " doesn't exist.";
 
         case UNABLE_TO_OPEN_FILE:
-            std::cerr << "Error: Unable to open '" << entityName << "'. Terminating...\n";
-            exit(UNABLE_TO_OPEN_FILE);
+            return "Unable to open '" + entityName + "'.";
 
         case DIR_NOT_FOUND:
-            std::cerr << "Error: Directory " << entityName << " doesn't exist. Terminating...\n";
-            exit(DIR_NOT_FOUND);
+            return "Directory " + entityName + " doesn't exist.";
 
         case UNABLE_TO_OPEN_FILE_FOR_WRITING:
-            std::cerr << "Error: Unable to open " << entityName << " for writing. Terminating...\n";
-            exit(UNABLE_TO_OPEN_FILE_FOR_WRITING);
+            return "Unable to open " + entityName + " for writing.";
+
+        case FAILED_TO_WRITE_FILE:
+            return "Failed while writing " + entityName + ".";
+
+        case INVALID_HEADER:
+            return entityName + " is not a valid code header.";
+
+        case CODE_TOO_LONG:
+            return "A code for " + entityName + " is longer than supported.";
+
+        case INVALID_CODE:
+            return entityName + " does not decode with its header.";
+
+        case LENGTH_LIMIT_TOO_SMALL:
+            return entityName + " is too short to give every word its own code.";
+
+        case DUPLICATE_OUTPUT:
+            return "Outputs of " + entityName + " would overwrite those of another input with the same name.";
+
+        case FAILED_TO_READ_FILE:
+            return "Failed while reading " + entityName + ".";
+
+        case NESTED_THREADS:
+            return "Scanning " + entityName + " would start more threads inside the --batch pool.";
 
         default:
-            std::cerr << "Error: Unknown error type. Terminating...\n";
+            return "Unknown error type.";
+    }
+}
+
+void exitOnError(error_type error, const std::string &entityName = "") {
+    if (error == NO_ERROR) {
+        return;
+    }
+    std::cerr << "Error: " << errorMessage(error, entityName) << " Terminating...\n";
+    switch (error) {
+        case FILE_NOT_FOUND:
+        case UNABLE_TO_OPEN_FILE:
+        case DIR_NOT_FOUND:
+        case UNABLE_TO_OPEN_FILE_FOR_WRITING:
+        case FAILED_TO_WRITE_FILE:
+        case INVALID_HEADER:
+        case CODE_TOO_LONG:
+        case INVALID_CODE:
+        case LENGTH_LIMIT_TOO_SMALL:
+        case DUPLICATE_OUTPUT:
+        case FAILED_TO_READ_FILE:
+        case NESTED_THREADS:
+            exit(error);
+        default:
             exit(ERR_TYPE_NOT_FOUND);
     }
 }
@@ -96,25 +139,38 @@ error_type canOpenForWriting(const std::string& filename) {
     return is_open ? NO_ERROR : UNABLE_TO_OPEN_FILE_FOR_WRITING;
 }
 
-error_type writeVectorToFile(const std::string& filename,
-                       const std::vector<std::string>& data) {
+template <typename Line>
+static error_type writeLinesToFile(const std::string& filename,
+                                   const std::vector<Line>& data) {
     // Open "fileName" for writing (truncating the file if it already exists).
     // If the file is opened successfully, write each element of "data"
-    // to it, placing one element on each line.
+    // to it, placing one element on each line. The lines are written by the
+    // I/O thread as the buffer fills, so the stream is checked once at the end.
 
-    std::ofstream out(filename, std::ios::out | std::ios::trunc);
-    if (!out.is_open()) {
+    OutputFile file;
+    if (file.open(filename) != NO_ERROR) {
         return UNABLE_TO_OPEN_FILE_FOR_WRITING;
     }
 
+    std::ostream& out = file.stream();
     for (const auto& item : data) {
         out << item << '\n';
-        if (!out) {
-            std::cerr << "Error: failed while writing to " << filename << "\n";
-            return FAILED_TO_WRITE_FILE;
-        }
+    }
+    if (!out || file.close() != NO_ERROR) {
+        std::cerr << "Error: failed while writing to " << filename << "\n";
+        return FAILED_TO_WRITE_FILE;
     }
 
     return NO_ERROR;
 }
 
+
+error_type writeVectorToFile(const std::string& filename,
+                       const std::vector<std::string>& data) {
+    return writeLinesToFile(filename, data);
+}
+
+error_type writeVectorToFile(const std::string& filename,
+                       const std::vector<std::string_view>& data) {
+    return writeLinesToFile(filename, data);
+}
@@ -4,6 +4,8 @@
 #pragma once
 
 #include <string>
+#include <string_view>
+#include <vector>
 
 #ifndef IMPLEMENTATION_UTILS_HPP
 #define IMPLEMENTATION_UTILS_HPP
@@ -17,8 +19,19 @@ enum error_type {
     ERR_TYPE_NOT_FOUND,
     UNABLE_TO_OPEN_FILE_FOR_WRITING,
     FAILED_TO_WRITE_FILE,
+    INVALID_ARGUMENTS,
+    INVALID_HEADER,
+    CODE_TOO_LONG,
+    INVALID_CODE,
+    LENGTH_LIMIT_TOO_SMALL,
+    DUPLICATE_OUTPUT,
+    FAILED_TO_READ_FILE,
+    NESTED_THREADS,
 };
 
+// Message for 'error' about 'entityName' (e.g. "File x doesn't exist.")
+std::string errorMessage(error_type error, const std::string& entityName);
+// Print the message to stderr and exit with the error's code
 void exitOnError(error_type error, const std::string& entityName);
 error_type regularFileExistsAndIsAvailable(const std::string &fileName);
 error_type fileExists(const std::string &name);
@@ -28,5 +41,7 @@ std::string baseNameWithoutTxt(const std::string& filename);
 error_type canOpenForWriting(const std::string& filename);
 error_type writeVectorToFile(const std::string& filename,
                              const std::vector<std::string> & lines);
+error_type writeVectorToFile(const std::string& filename,
+                             const std::vector<std::string_view> & lines);
 
 #endif //IMPLEMENTATION_UTILS_HPP
\ No newline at end of file